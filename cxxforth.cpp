@@ -158,23 +158,42 @@ those words and want a smaller executable.
 #include "cxxforth.h"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <chrono>
+#include <csetjmp>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <exception>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <list>
+#include <map>
+#include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #ifndef CXXFORTH_DISABLE_FILE_ACCESS
 #include <cstdio>
 #include <fstream>
 #endif
 
+#if defined(CXXFORTH_JIT) || defined(CXXFORTH_GUARD_PAGES)
+#include <sys/mman.h>
+#endif
+
+#ifdef CXXFORTH_GUARD_PAGES
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
 using std::cerr;
 using std::cout;
 using std::endl;
@@ -216,8 +235,9 @@ Configuration Constants
 -----------------------
 
 I have a few macros to define the size of the Forth data space, the maximum
-numbers of cells on the data and return stacks, and the maximum number of word
-definitions in the dictionary.
+numbers of cells on the data and return stacks, the maximum depth of nested
+colon definition calls, and the size of the code space used by the
+token-threaded inner interpreter and the native code compiler.
 
 These macros are usually defined in the `cxxforthconfig.h` header that is
 generated by CMake and included by `cxxforth.h`, but I provide default values
@@ -241,6 +261,34 @@ in case they have not been defined.
 #define CXXFORTH_RSTACK_COUNT (256)
 #endif
 
+#ifndef CXXFORTH_CALLSTACK_COUNT
+#define CXXFORTH_CALLSTACK_COUNT (64 * 1024)
+#endif
+
+#ifndef CXXFORTH_CODESPACE_SIZE
+#define CXXFORTH_CODESPACE_SIZE (256 * 1024)
+#endif
+
+#if (defined(CXXFORTH_DIRECT_THREADED) + defined(CXXFORTH_TOKEN_THREADED) + defined(CXXFORTH_JIT)) > 1
+#error "Only one of CXXFORTH_DIRECT_THREADED, CXXFORTH_TOKEN_THREADED, and CXXFORTH_JIT can be defined"
+#endif
+
+#if defined(CXXFORTH_JIT) && !defined(__x86_64__)
+#error "CXXFORTH_JIT requires an x86-64 platform"
+#endif
+
+#if defined(CXXFORTH_DIRECT_THREADED) || defined(CXXFORTH_TOKEN_THREADED) || defined(CXXFORTH_JIT)
+#define CXXFORTH_TIERED
+#endif
+
+#ifndef CXXFORTH_TIER_THRESHOLD
+#define CXXFORTH_TIER_THRESHOLD (100)
+#endif
+
+#ifndef CXXFORTH_INLINE_LIMIT
+#define CXXFORTH_INLINE_LIMIT (6)
+#endif
+
 /****
 
 ----
@@ -346,10 +394,33 @@ of the `Definition` that was most recently executed.  This can be used by
 Finally, `Definition` has a few member functions for executing the code and for
 accessing the _hidden_ and _immediate_ flags.
 
+If cxxforth is built with the direct-threaded or token-threaded inner
+interpreter or the native code compiler described later, a `Definition` also
+caches a pointer to the translated form of its Forth instructions in the
+`threaded`, `tokens`, or `native` field, and counts how often it has been
+executed before being translated in its `calls` field.
+
+When `;` completes a colon definition, the optimizer tries to work out the
+definition's stack effect, and keeps it in the `effect` field.  This is
+described in **Stack Effects**.
+
 ****/
 
 using Code = void(*)();
 
+// The numbers of data stack cells that a sequence of instructions takes and
+// leaves, and the most cells it adds to the stack at any point.
+struct StackEffect {
+    size_t in    = 0;
+    size_t out   = 0;
+    size_t peak  = 0;
+    bool   known = false;
+};
+
+#ifdef CXXFORTH_JIT
+struct NativeWord;
+#endif
+
 struct Definition {
     Code   code      = nullptr;
     AAddr  does      = nullptr;
@@ -357,8 +428,34 @@ struct Definition {
     Cell   flags     = 0;
     string name;
 
+    StackEffect effect;       // of the instructions at does, if known
+
+#ifdef CXXFORTH_DIRECT_THREADED
+    mutable const Cell* threaded = nullptr;
+    mutable const Cell* uncheckedThreaded = nullptr;
+#endif
+
+#ifdef CXXFORTH_TOKEN_THREADED
+    mutable const Char* tokens = nullptr;
+#endif
+
+#ifdef CXXFORTH_JIT
+    mutable const NativeWord* native = nullptr;
+    mutable const NativeWord* uncheckedNative = nullptr;
+#endif
+
+#ifdef CXXFORTH_TIERED
+    mutable Cell calls = 0;   // calls and backward branches while interpreted
+#endif
+
+#ifdef CXXFORTH_COMPILED_FILE
+    Code compiled = nullptr;  // translation written by SAVE-CXX, if any
+#endif
+
     static constexpr Cell FlagHidden    = (1 << 1);
     static constexpr Cell FlagImmediate = (1 << 2);
+    static constexpr Cell FlagNoInline  = (1 << 3);
+    static constexpr Cell FlagUnchecked = (1 << 4);
 
     static const Definition* executingWord;
 
@@ -377,6 +474,10 @@ struct Definition {
 
     void toggleImmediate()   { flags ^= FlagImmediate; }
 
+    bool isNoInline() const  { return (flags & FlagNoInline) != 0; }
+
+    bool isUnchecked() const { return (flags & FlagUnchecked) != 0; }
+
     bool isFindable() const  { return !name.empty() && !isHidden(); }
 };
 
@@ -403,16 +504,81 @@ data space and the data and return stacks.
 For each of these arrays, there are constants that point to the end of the
 array, so I can easily test whether I need to report an overflow.
 
+Testing before every push adds up, though.  If the macro
+`CXXFORTH_GUARD_PAGES` is defined (pass `-DCXXFORTH_GUARD_PAGES=ON` to
+`cmake`), each array is instead allocated with `mmap()`, and placed so that it
+ends exactly at a page boundary, with `GuardSize` bytes of inaccessible
+memory on each side of it.  Then an overflow doesn't need to be tested for:
+whatever pushes the first cell past the end of a stack, or stores past the end
+of the data space, gets a `SIGSEGV` signal, which is turned into an
+`AbortException` as described in **Guard Page Faults** below.  That works as
+long as nothing jumps over the guard, so a check is still needed for any push
+of more than `GuardCells` cells at once; `needsAvailableCheck()` says whether
+the check for `n` cells can be left out.  The guard below each array catches
+underflows that go far enough, but the underflow checks are still made, because
+most underflows only reach the spare memory below the start of the array.
+
 ****/
 
+#ifdef CXXFORTH_GUARD_PAGES
+
+constexpr size_t GuardSize  = 64 * 1024;
+constexpr size_t GuardCells = GuardSize / sizeof(Cell);
+
+struct GuardedArray {
+    CAddr base;   // start of the mapping, which begins with the lower guard
+    CAddr start;  // first byte of the array
+    CAddr limit;  // end of the array, and start of the upper guard
+    CAddr end;    // end of the mapping
+};
+
+// Allocate an array of size bytes with guard pages below and above it.
+GuardedArray allocateGuarded(size_t size) {
+    auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto guard = (GuardSize + pageSize - 1) / pageSize * pageSize;
+    auto usable = (size + pageSize - 1) / pageSize * pageSize;
+    auto total = guard + usable + guard;
+    auto base = CADDR(mmap(nullptr, total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED || mprotect(base + guard, usable, PROT_READ | PROT_WRITE) != 0) {
+        cerr << "cxxforth: unable to allocate guarded memory" << endl;
+        std::abort();
+    }
+    auto limit = base + guard + usable;
+    return {base, limit - size, limit, base + total};
+}
+
+const GuardedArray dataSpaceArray = allocateGuarded(CXXFORTH_DATASPACE_SIZE);
+const GuardedArray dStackArray    = allocateGuarded((CXXFORTH_DSTACK_COUNT + 1) * sizeof(Cell));
+const GuardedArray rStackArray    = allocateGuarded(CXXFORTH_RSTACK_COUNT * sizeof(Cell));
+
+const CAddr dataSpace   = dataSpaceArray.start;
+const AAddr dStackCells = AADDR(dStackArray.start);  // see "Caching the Top of the Stack"
+const AAddr rStack      = AADDR(rStackArray.start);
+
+const AAddr dStack         = &dStackCells[1];
+
+const CAddr dataSpaceLimit = dataSpaceArray.limit;
+const AAddr dStackLimit    = AADDR(dStackArray.limit);
+const AAddr rStackLimit    = AADDR(rStackArray.limit);
+
+constexpr bool needsAvailableCheck(size_t n) { return n > GuardCells; }
+
+#else
+
 Char dataSpace[CXXFORTH_DATASPACE_SIZE];
-Cell dStack[CXXFORTH_DSTACK_COUNT];
+Cell dStackCells[CXXFORTH_DSTACK_COUNT + 1];  // see "Caching the Top of the Stack"
 Cell rStack[CXXFORTH_RSTACK_COUNT];
 
+constexpr AAddr dStack         = &dStackCells[1];
+
 constexpr CAddr dataSpaceLimit = &dataSpace[CXXFORTH_DATASPACE_SIZE];
-constexpr AAddr dStackLimit    = &dStack[CXXFORTH_DSTACK_COUNT];
+constexpr AAddr dStackLimit    = &dStackCells[CXXFORTH_DSTACK_COUNT + 1];
 constexpr AAddr rStackLimit    = &rStack[CXXFORTH_RSTACK_COUNT];
 
+constexpr bool needsAvailableCheck(size_t) { return true; }
+
+#endif // CXXFORTH_GUARD_PAGES
+
 /****
 
 The Forth dictionary is a list of `Definition`s.  The most recent definition is
@@ -451,6 +617,29 @@ Xt* nextInstruction = nullptr;
 
 /****
 
+It also needs somewhere to keep the return addresses of the colon definitions
+it is in the middle of, which is the _call stack_.  This is also explained in
+the **Inner Interpreter** section.  `callTop` points to its top element, like
+`rTop`.
+
+****/
+
+Xt*  callStack[CXXFORTH_CALLSTACK_COUNT];
+Xt** callTop = nullptr;
+
+constexpr Xt** callStackLimit = &callStack[CXXFORTH_CALLSTACK_COUNT];
+
+/****
+
+A definition with local variables keeps them in a frame on the return stack,
+and `localFrame` points to the first of them.  See **Locals** below.
+
+****/
+
+AAddr localFrame = nullptr;
+
+/****
+
 I have to define the static `executingWord` member declared in `Definition`.
 
 ****/
@@ -466,9 +655,28 @@ cache their values during initialization.
 ****/
 
 Xt doLiteralXt       = nullptr;
+Xt branchXt          = nullptr;
+Xt zbranchXt         = nullptr;
+Xt litPlusXt         = nullptr;
+Xt litEqualsXt       = nullptr;
+Xt dupZbranchXt      = nullptr;
+Xt nzbranchXt        = nullptr;
+Xt equalsBranchXt    = nullptr;
+Xt notEqualsBranchXt = nullptr;
+Xt lessBranchXt      = nullptr;
+Xt greaterBranchXt   = nullptr;
+Xt tailCallXt        = nullptr;
+Xt qdoXt             = nullptr;
+Xt loopXt            = nullptr;
+Xt plusLoopXt        = nullptr;
 Xt setDoesXt         = nullptr;
+Xt abortXt           = nullptr;
 Xt exitXt            = nullptr;
 Xt endOfDefinitionXt = nullptr;
+Xt localFetchXt      = nullptr;
+Xt localStoreXt      = nullptr;
+Xt localsXt          = nullptr;
+Xt unlocalsXt        = nullptr;
 
 /****
 
@@ -585,9 +793,11 @@ void resetDStack() {
     dTop = dStack - 1;
 }
 
-// Make the return stack empty.
+// Make the return stack, and the call stack that goes with it, empty.
 void resetRStack() {
     rTop = rStack - 1;
+    callTop = callStack - 1;
+    localFrame = nullptr;
 }
 
 // Return the depth of the data stack.
@@ -631,6 +841,33 @@ Forth provides the `ABORT` and `ABORT"` words, which interrupt execution and
 return control to the main `QUIT` loop.  I will implement this functionality
 using a C++ exception to return control to the top-level interpreter.
 
+The standard also provides `CATCH` and `THROW`.  `CATCH` executes an XT, and
+if anything it calls executes `THROW` with a non-zero _throw code_, execution
+continues after the `CATCH`, with the data and return stacks restored to their
+depths when `CATCH` was called, and the code on top of the data stack.  `ABORT`
+is `-1 THROW`, and `ABORT"` is `-2 THROW` with a message, and the errors
+detected by cxxforth itself have the standard codes listed below.  An
+`AbortException` carries its throw code, so a `CATCH` can catch it just like
+any other exception.
+
+C++ exceptions aren't fast, though.  Throwing one allocates memory, and then
+the C++ runtime has to unwind every C++ stack frame between the `THROW` and
+the `CATCH`, and there can be several of those for each nested Forth
+definition.  Programs that use `THROW` to handle bad input can spend most of
+their time there.  So each `CATCH` also saves its state in a `CatchFrame` on
+the C++ stack, with a `jmp_buf`, pushes the frame's address onto the return
+stack, and makes the frame the innermost one.  `throwCode()` can then just
+`longjmp()` back to the `CATCH`, as long as that doesn't skip anything that
+needs to be cleaned up.  A C++ function that has to see the exceptions that
+pass through it, or owns something that its destructors have to free, and that
+can execute Forth words, declares an `UnwindBarrier` to make `throwCode()` throw
+a C++ exception instead.  Only `EVALUATE` and `INCLUDE-FILE` need to do that.
+The inner interpreters don't need to, because `CATCH` restores the few things
+they would have restored themselves, including the top of the call stack
+described in **Inner Interpreter** and the frame pointer described in
+**Locals**.  So they must not own anything that a destructor frees: what they
+track for each call goes on the call stack, or in an array beside it.
+
 The C++ functions `abort()` and `abortMessage()` defined here are the first
 primitive functions that will be exposed as Forth words.  For each such word, I
 will spell out the Forth name of the primitive in all-caps, and provide a Forth
@@ -640,17 +877,93 @@ standard words, I'll provide a brief description.
 
 ****/
 
+constexpr SCell ThrowAbort                = -1;
+constexpr SCell ThrowAbortMessage         = -2;
+constexpr SCell ThrowStackOverflow        = -3;
+constexpr SCell ThrowStackUnderflow       = -4;
+constexpr SCell ThrowReturnStackOverflow  = -5;
+constexpr SCell ThrowReturnStackUnderflow = -6;
+constexpr SCell ThrowDictionaryOverflow   = -8;
+constexpr SCell ThrowInvalidAddress       = -9;
+constexpr SCell ThrowDivisionByZero       = -10;
+constexpr SCell ThrowUndefinedWord        = -13;
+constexpr SCell ThrowZeroLengthName       = -16;
+constexpr SCell ThrowUnalignedAddress     = -23;
+constexpr SCell ThrowInvalidArgument      = -24;
+constexpr SCell ThrowFileIO               = -37;
+
 class AbortException: public runtime_error {
 public:
+    SCell code = ThrowAbortMessage;
+
     explicit AbortException(const string& msg): runtime_error(msg) {}
     explicit AbortException(const char* msg): runtime_error(msg) {}
     explicit AbortException(const char* caddr, size_t count)
         : runtime_error(string(caddr, count)) {}
+    AbortException(const string& msg, SCell c): runtime_error(msg), code(c) {}
+    AbortException(const char* msg, SCell c): runtime_error(msg), code(c) {}
+};
+
+// Return the message to be displayed for an uncaught throw code.
+string throwMessage(SCell code) {
+    switch (code) {
+        case ThrowAbort:                return "";
+        case ThrowStackOverflow:        return "stack overflow";
+        case ThrowStackUnderflow:       return "stack underflow";
+        case ThrowReturnStackOverflow:  return "return stack overflow";
+        case ThrowReturnStackUnderflow: return "return stack underflow";
+        case ThrowDictionaryOverflow:   return "data space overflow";
+        case ThrowInvalidAddress:       return "invalid memory address";
+        case ThrowDivisionByZero:       return "division by zero";
+        case ThrowUndefinedWord:        return "undefined word";
+        default:                        return "uncaught exception " + std::to_string(code);
+    }
+}
+
+struct CatchFrame {
+    CatchFrame*       previous;
+    ptrdiff_t         dDepth;
+    AAddr             rTop;
+    Xt**              callTop;
+    AAddr             localFrame;
+    const Definition* executingWord;
+    Xt*               nextInstruction;
+    size_t            barriers;
+    std::jmp_buf      jump;
 };
 
+CatchFrame* catchFrame    = nullptr;  // innermost CATCH
+size_t      unwindBarriers = 0;       // number of live UnwindBarriers
+SCell       thrownCode    = 0;        // code passed to jumpToCatch()
+
+struct UnwindBarrier {
+    UnwindBarrier()  { ++unwindBarriers; }
+    ~UnwindBarrier() { --unwindBarriers; }
+};
+
+// Return true if the innermost CATCH can be returned to with longjmp().
+bool canJumpToCatch() {
+    return catchFrame != nullptr && catchFrame->barriers == unwindBarriers;
+}
+
+[[noreturn]] void jumpToCatch(SCell code) {
+    thrownCode = code;
+    std::longjmp(catchFrame->jump, 1);
+}
+
+// Throw a non-zero code to the innermost CATCH.  The message, or if there is
+// none, the one from throwMessage(), is displayed if the code isn't caught.
+[[noreturn]] void throwCode(SCell code, const char* caddr = nullptr, size_t count = 0) {
+    if (canJumpToCatch())
+        jumpToCatch(code);
+    if (caddr != nullptr)
+        throw AbortException(string(caddr, count), code);
+    throw AbortException(throwMessage(code), code);
+}
+
 // ABORT ( i*x -- ) ( R: j*x -- )
 void abort() {
-    throw AbortException("");
+    throwCode(ThrowAbort);
 }
 
 // ABORT-MESSAGE ( i*x c-addr u -- ) ( R: j*x -- )
@@ -662,7 +975,7 @@ void abort() {
 void abortMessage() {
     auto count = SIZE_T(*dTop); pop();
     auto caddr = CHARPTR(*dTop); pop();
-    throw AbortException(caddr, count);
+    throwCode(ThrowAbortMessage, caddr, count);
 }
 
 /****
@@ -686,73 +999,99 @@ You can define the macro `CXXFORTH_SKIP_RUNTIME_CHECKS` to generate an
 executable that doesn't include these checks, so when you have a fully debugged
 Forth application you can run it on that optimized executable for improved
 performance.
+In the builds that translate definitions, the non-standard word `UNCHECKED`
+does the same for the data stack checks of a single definition, in the same
+executable; see **Tiered Execution**.
 
 When the `CXXFORTH_SKIP_RUNTIME_CHECKS` macro is not defined, these macros will
 check conditions and throw an `AbortException` if the assertions fail.  I won't
 go into the details of these macros here.  Later we will see them used in the
 definitions of our primitive Forth words.
 
+If `CXXFORTH_GUARD_PAGES` is defined, the checks for room on the stacks and in
+the data space are left out wherever the guard pages described in **Global
+Variables** make them unnecessary, whether or not the other checks are made.
+
+The stack checks throw their exceptions by calling a separate function,
+`throwCheckFailure()`, so that each check itself is just a comparison and a
+branch.  Otherwise, as the inner interpreters grow, the compiler may decide to
+stop expanding the checks inline.
+
 ****/
 
 #ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
 
 #define RUNTIME_NO_OP()                      do { } while (0)
-#define RUNTIME_ERROR(msg)                   RUNTIME_NO_OP()
-#define RUNTIME_ERROR_IF(cond, msg)          RUNTIME_NO_OP()
+#define RUNTIME_ERROR(msg, code)             RUNTIME_NO_OP()
+#define RUNTIME_ERROR_IF(cond, msg, code)    RUNTIME_NO_OP()
 #define REQUIRE_DSTACK_DEPTH(n, name)        RUNTIME_NO_OP()
 #define REQUIRE_DSTACK_AVAILABLE(n, name)    RUNTIME_NO_OP()
 #define REQUIRE_RSTACK_DEPTH(n, name)        RUNTIME_NO_OP()
 #define REQUIRE_RSTACK_AVAILABLE(n, name)    RUNTIME_NO_OP()
+#define REQUIRE_CALLSTACK_AVAILABLE(name)    RUNTIME_NO_OP()
 #define REQUIRE_ALIGNED(addr, name)          RUNTIME_NO_OP()
 #define REQUIRE_VALID_HERE(name)             RUNTIME_NO_OP()
 #define REQUIRE_DATASPACE_AVAILABLE(n, name) RUNTIME_NO_OP()
 
 #else
 
-#define RUNTIME_ERROR(msg)                   do { throw AbortException(msg); } while (0)
-#define RUNTIME_ERROR_IF(cond, msg)          do { if (cond) RUNTIME_ERROR(msg); } while (0)
+#define RUNTIME_ERROR(msg, code)             do { throw AbortException(msg, code); } while (0)
+#define RUNTIME_ERROR_IF(cond, msg, code)    do { if (cond) RUNTIME_ERROR(msg, code); } while (0)
 #define REQUIRE_DSTACK_DEPTH(n, name)        requireDStackDepth(n, name)
-#define REQUIRE_DSTACK_AVAILABLE(n, name)    requireDStackAvailable(n, name)
+#define REQUIRE_DSTACK_AVAILABLE(n, name)    do { if (needsAvailableCheck(n)) requireDStackAvailable(n, name); } while (0)
 #define REQUIRE_RSTACK_DEPTH(n, name)        requireRStackDepth(n, name)
-#define REQUIRE_RSTACK_AVAILABLE(n, name)    requireRStackAvailable(n, name)
+#define REQUIRE_RSTACK_AVAILABLE(n, name)    do { if (needsAvailableCheck(n)) requireRStackAvailable(n, name); } while (0)
+#define REQUIRE_CALLSTACK_AVAILABLE(name)    requireCallStackAvailable(name)
 #define REQUIRE_ALIGNED(addr, name)          checkAligned(addr, name)
 #define REQUIRE_VALID_HERE(name)             checkValidHere(name)
-#define REQUIRE_DATASPACE_AVAILABLE(n, name) requireDataSpaceAvailable(n, name)
+#define REQUIRE_DATASPACE_AVAILABLE(n, name) do { if (needsAvailableCheck(n)) requireDataSpaceAvailable(n, name); } while (0)
 
 template<typename T>
 void checkAligned(T addr, const char* name) {
     RUNTIME_ERROR_IF((CELL(addr) % CellSize) != 0,
-                     string(name) + ": unaligned address");
+                     string(name) + ": unaligned address", ThrowUnalignedAddress);
+}
+
+[[noreturn]] void throwCheckFailure(const char* name, const char* problem, SCell code) {
+    throw AbortException(string(name) + problem, code);
 }
 
 void requireDStackDepth(size_t n, const char* name) {
-    RUNTIME_ERROR_IF(dStackDepth() < static_cast<ptrdiff_t>(n),
-                     string(name) + ": stack underflow");
+    if (dStackDepth() < static_cast<ptrdiff_t>(n))
+        throwCheckFailure(name, ": stack underflow", ThrowStackUnderflow);
 }
 
 void requireDStackAvailable(size_t n, const char* name) {
-    RUNTIME_ERROR_IF((dTop + n) >= dStackLimit,
-                     string(name) + ": stack overflow");
+    if ((dTop + n) >= dStackLimit)
+        throwCheckFailure(name, ": stack overflow", ThrowStackOverflow);
 }
 
 void requireRStackDepth(size_t n, const char* name) {
-    RUNTIME_ERROR_IF(rStackDepth() < ptrdiff_t(n),
-                     string(name) + ": return stack underflow");
+    if (rStackDepth() < ptrdiff_t(n))
+        throwCheckFailure(name, ": return stack underflow", ThrowReturnStackUnderflow);
 }
 
 void requireRStackAvailable(size_t n, const char* name) {
-    RUNTIME_ERROR_IF((rTop + n) >= rStackLimit,
-                     string(name) + ": return stack overflow");
+    if ((rTop + n) >= rStackLimit)
+        throwCheckFailure(name, ": return stack overflow", ThrowReturnStackOverflow);
+}
+
+void requireCallStackAvailable(const char* name) {
+    if ((callTop + 1) >= callStackLimit)
+        throwCheckFailure(name, ": call stack overflow", ThrowReturnStackOverflow);
 }
 
+// HERE may be at the end of the data space, when it is full.  Adding to it
+// there is an overflow, reported by requireDataSpaceAvailable(), or in a
+// guarded build by the guard page that the store hits.
 void checkValidHere(const char* name) {
-    RUNTIME_ERROR_IF(dataPointer < dataSpace || dataSpaceLimit <= dataPointer,
-                     string(name) + ": HERE outside data space");
+    RUNTIME_ERROR_IF(dataPointer < dataSpace || dataSpaceLimit < dataPointer,
+                     string(name) + ": HERE outside data space", ThrowInvalidAddress);
 }
 
 void requireDataSpaceAvailable(size_t n, const char* name) {
     RUNTIME_ERROR_IF((dataPointer + n) >= dataSpaceLimit,
-                     string(name) + ": data space overflow");
+                     string(name) + ": data space overflow", ThrowDictionaryOverflow);
 }
 
 #endif // CXXFORTH_SKIP_RUNTIME_CHECKS
@@ -841,6 +1180,91 @@ void roll() {
     }
 }
 
+/****
+
+The rest of the stack operations could be defined in Forth using `PICK` and
+`ROLL`, and the Forth definitions appear in the `forthDefinitions` below.  But
+these words are used everywhere, and `2 ROLL` takes a trip through
+`std::memmove()` just to rearrange three cells, so by default I implement them
+as primitives too.  If cxxforth is built with the macro
+`CXXFORTH_FORTH_CORE_WORDS` defined (pass `-DCXXFORTH_FORTH_CORE_WORDS=ON` to
+`cmake`), then these primitives, and a few others below that also have Forth
+definitions, are left out of the dictionary, and the Forth definitions are
+used instead.  I call them the _core words_.
+
+****/
+
+// OVER ( x1 x2 -- x1 x2 x1 )
+void over() {
+    REQUIRE_DSTACK_DEPTH(2, "OVER");
+    REQUIRE_DSTACK_AVAILABLE(1, "OVER");
+    push(*(dTop - 1));
+}
+
+// ROT ( x1 x2 x3 -- x2 x3 x1 )
+void rot() {
+    REQUIRE_DSTACK_DEPTH(3, "ROT");
+    auto x1 = *(dTop - 2);
+    *(dTop - 2) = *(dTop - 1);
+    *(dTop - 1) = *dTop;
+    *dTop = x1;
+}
+
+// NIP ( x1 x2 -- x2 )
+void nip() {
+    REQUIRE_DSTACK_DEPTH(2, "NIP");
+    auto x2 = *dTop; pop();
+    *dTop = x2;
+}
+
+// TUCK ( x1 x2 -- x2 x1 x2 )
+void tuck() {
+    REQUIRE_DSTACK_DEPTH(2, "TUCK");
+    REQUIRE_DSTACK_AVAILABLE(1, "TUCK");
+    auto x2 = *dTop;
+    *dTop = *(dTop - 1);
+    *(dTop - 1) = x2;
+    push(x2);
+}
+
+// 2DROP ( x1 x2 -- )
+void twoDrop() {
+    REQUIRE_DSTACK_DEPTH(2, "2DROP");
+    dTop -= 2;
+}
+
+// 2DUP ( x1 x2 -- x1 x2 x1 x2 )
+void twoDup() {
+    REQUIRE_DSTACK_DEPTH(2, "2DUP");
+    REQUIRE_DSTACK_AVAILABLE(2, "2DUP");
+    push(*(dTop - 1));
+    push(*(dTop - 1));
+}
+
+// 2OVER ( x1 x2 x3 x4 -- x1 x2 x3 x4 x1 x2 )
+void twoOver() {
+    REQUIRE_DSTACK_DEPTH(4, "2OVER");
+    REQUIRE_DSTACK_AVAILABLE(2, "2OVER");
+    push(*(dTop - 3));
+    push(*(dTop - 3));
+}
+
+// 2SWAP ( x1 x2 x3 x4 -- x3 x4 x1 x2 )
+void twoSwap() {
+    REQUIRE_DSTACK_DEPTH(4, "2SWAP");
+    std::swap(*dTop, *(dTop - 2));
+    std::swap(*(dTop - 1), *(dTop - 3));
+}
+
+// ?DUP ( x -- 0 | x x )
+void questionDup() {
+    REQUIRE_DSTACK_DEPTH(1, "?DUP");
+    if (*dTop != 0) {
+        REQUIRE_DSTACK_AVAILABLE(1, "?DUP");
+        push(*dTop);
+    }
+}
+
 // >R ( x -- ) ( R:  -- x )
 void toR() {
     REQUIRE_DSTACK_DEPTH(1, ">R");
@@ -956,7 +1380,10 @@ void here() {
 void allot() {
     REQUIRE_DSTACK_DEPTH(1, "ALLOT");
     REQUIRE_VALID_HERE("ALLOT");
-    REQUIRE_DATASPACE_AVAILABLE(CellSize, "ALLOT");
+    RUNTIME_ERROR_IF(static_cast<SCell>(*dTop) > dataSpaceLimit - dataPointer,
+                     "ALLOT: data space overflow", ThrowDictionaryOverflow);
+    RUNTIME_ERROR_IF(static_cast<SCell>(*dTop) < dataSpace - dataPointer,
+                     "ALLOT: HERE outside data space", ThrowInvalidAddress);
     dataPointer += *dTop; pop();
 }
 
@@ -975,6 +1402,22 @@ void data(Cell x) {
     dataPointer += CellSize;
 }
 
+// , ( x -- )
+void comma() {
+    REQUIRE_DSTACK_DEPTH(1, ",");
+    auto x = *dTop; pop();
+    data(x);
+}
+
+// C, ( char -- )
+void cComma() {
+    REQUIRE_DSTACK_DEPTH(1, "C,");
+    REQUIRE_VALID_HERE("C,");
+    REQUIRE_DATASPACE_AVAILABLE(1, "C,");
+    *dataPointer = static_cast<Char>(*dTop); pop();
+    ++dataPointer;
+}
+
 // UNUSED ( -- u )
 void unused() {
     REQUIRE_DSTACK_AVAILABLE(1, "UNUSED");
@@ -1075,6 +1518,14 @@ void emit() {
     cout.put(static_cast<char>(cell));
 }
 
+// SPACES ( n -- )
+void spaces() {
+    REQUIRE_DSTACK_DEPTH(1, "SPACES");
+    auto n = static_cast<SCell>(*dTop); pop();
+    for (; n > 0; --n)
+        cout.put(' ');
+}
+
 // TYPE ( c-addr u -- )
 void type() {
     REQUIRE_DSTACK_DEPTH(2, "TYPE");
@@ -1356,7 +1807,7 @@ void slash() {
     REQUIRE_DSTACK_DEPTH(2, "/");
     auto n2 = static_cast<SCell>(*dTop); pop();
     auto n1 = static_cast<SCell>(*dTop);
-    RUNTIME_ERROR_IF(n2 == 0, "/: zero divisor");
+    RUNTIME_ERROR_IF(n2 == 0, "/: zero divisor", ThrowDivisionByZero);
     *dTop = static_cast<Cell>(n1 / n2);
 }
 
@@ -1365,7 +1816,7 @@ void slashMod() {
     REQUIRE_DSTACK_DEPTH(2, "/MOD");
     auto n2 = static_cast<SCell>(*dTop);
     auto n1 = static_cast<SCell>(*(dTop - 1));
-    RUNTIME_ERROR_IF(n2 == 0, "/MOD: zero divisor");
+    RUNTIME_ERROR_IF(n2 == 0, "/MOD: zero divisor", ThrowDivisionByZero);
     auto result = std::ldiv(n1, n2);
     *(dTop - 1) = static_cast<Cell>(result.rem);
     *dTop = static_cast<Cell>(result.quot);
@@ -1373,6 +1824,75 @@ void slashMod() {
 
 /****
 
+Here are the arithmetic core words, including `+!`.
+
+****/
+
+// 1+ ( n1 -- n2 )
+void onePlus() {
+    REQUIRE_DSTACK_DEPTH(1, "1+");
+    *dTop += 1;
+}
+
+// 1- ( n1 -- n2 )
+void oneMinus() {
+    REQUIRE_DSTACK_DEPTH(1, "1-");
+    *dTop -= 1;
+}
+
+// 2* ( x1 -- x2 )
+void twoStar() {
+    REQUIRE_DSTACK_DEPTH(1, "2*");
+    *dTop <<= 1;
+}
+
+// 2/ ( x1 -- x2 )
+//
+// Like the Forth definition, this is a logical shift.
+void twoSlash() {
+    REQUIRE_DSTACK_DEPTH(1, "2/");
+    *dTop >>= 1;
+}
+
+// NEGATE ( n1 -- n2 )
+void negate() {
+    REQUIRE_DSTACK_DEPTH(1, "NEGATE");
+    *dTop = 0 - *dTop;
+}
+
+// ABS ( n -- u )
+void absValue() {
+    REQUIRE_DSTACK_DEPTH(1, "ABS");
+    if (static_cast<SCell>(*dTop) < 0)
+        *dTop = 0 - *dTop;
+}
+
+// MIN ( n1 n2 -- n3 )
+void minimum() {
+    REQUIRE_DSTACK_DEPTH(2, "MIN");
+    auto n2 = static_cast<SCell>(*dTop); pop();
+    auto n1 = static_cast<SCell>(*dTop);
+    *dTop = static_cast<Cell>(std::min(n1, n2));
+}
+
+// MAX ( n1 n2 -- n3 )
+void maximum() {
+    REQUIRE_DSTACK_DEPTH(2, "MAX");
+    auto n2 = static_cast<SCell>(*dTop); pop();
+    auto n1 = static_cast<SCell>(*dTop);
+    *dTop = static_cast<Cell>(std::max(n1, n2));
+}
+
+// +! ( n|u a-addr -- )
+void plusStore() {
+    REQUIRE_DSTACK_DEPTH(2, "+!");
+    auto aaddr = AADDR(*dTop); pop();
+    REQUIRE_ALIGNED(aaddr, "+!");
+    *aaddr += *dTop; pop();
+}
+
+/****
+
 Next, I define logical and relational primitives.
 
 ****/
@@ -1435,6 +1955,44 @@ void uLessThan() {
 
 /****
 
+And these are the logical and relational core words.
+
+****/
+
+// INVERT ( x1 -- x2 )
+void invert() {
+    REQUIRE_DSTACK_DEPTH(1, "INVERT");
+    *dTop = ~*dTop;
+}
+
+// > ( n1 n2 -- flag )
+void greaterThan() {
+    REQUIRE_DSTACK_DEPTH(2, ">");
+    auto n2 = static_cast<SCell>(*dTop); pop();
+    *dTop = static_cast<SCell>(*dTop) > n2 ? True : False;
+}
+
+// <> ( x1 x2 -- flag )
+void notEquals() {
+    REQUIRE_DSTACK_DEPTH(2, "<>");
+    auto x2 = *dTop; pop();
+    *dTop = *dTop != x2 ? True : False;
+}
+
+// 0< ( n -- flag )
+void zeroLess() {
+    REQUIRE_DSTACK_DEPTH(1, "0<");
+    *dTop = static_cast<SCell>(*dTop) < 0 ? True : False;
+}
+
+// 0= ( x -- flag )
+void zeroEquals() {
+    REQUIRE_DSTACK_DEPTH(1, "0=");
+    *dTop = *dTop == 0 ? True : False;
+}
+
+/****
+
 Now I will define a few primitives that give access to operating-system and
 environmental data.
 
@@ -1459,7 +2017,7 @@ void argAtIndex() {
     REQUIRE_DSTACK_DEPTH(1, "ARG");
     REQUIRE_DSTACK_AVAILABLE(1, "ARG");
     auto index = static_cast<size_t>(*dTop);
-    RUNTIME_ERROR_IF(index >= commandLineArgCount, "ARG: invalid index");
+    RUNTIME_ERROR_IF(index >= commandLineArgCount, "ARG: invalid index", ThrowInvalidArgument);
     auto value = commandLineArgVector[index];
     *dTop = CELL(value);
     push(std::strlen(value));
@@ -1584,83 +2142,530 @@ Each colon definition ends with a call to `EXIT`, which sets up a return to the
 colon definition that called the current word.  In many traditional Forths, the
 `EXIT` instruction is implemented as a jump/branch to the next machine-code
 instruction to be executed.  But that's not easy to do in a portable way in
-C++, so my `doColon()` just keeps going until it sees an `EXIT` instruction,
-then returns to the caller without actually executing it.
+C++, so `doColon()` calls `interpretBody()`, which just keeps going until it
+sees an `EXIT` instruction, then returns to the caller without actually
+executing it.
+
+If `interpretBody()` called `execute()` for every instruction, though, each
+call from one colon definition to another would be a nested call of
+`doColon()` and `interpretBody()`, using some C++ stack space for each level of
+Forth calls, and a deeply recursive Forth word would crash cxxforth when the
+C++ stack ran out.  So `interpretBody()` handles calls to colon definitions and
+`DOES>` words itself, as well as `DEFER`red words whose actions are colon
+definitions, running the whole call tree in one loop.  To call a word,
+it pushes `nextInstruction` onto the _call stack_ and sets `nextInstruction` to
+the first instruction of the called word.  When it sees an `EXIT`, it pops the
+return address back off the call stack, and only returns to its own caller
+when the call stack is back where it started.  The call stack can hold
+`CXXFORTH_CALLSTACK_COUNT` return addresses, and running out of room is a
+"return stack overflow" that can be caught like any other.  Only a word
+executed by a primitive, as `EXECUTE` does, starts a new level of C++ calls.
 
 In many Forth implementations, the return stack is used to store the address of
 the next instruction to be invoked upon returning from the routine.  But in
-C++, I can just use a temporary variable to achieve the same thing.  So in this
-Forth, the return stack is really just a secondary stack; it doesn't have
-anything to do with "returning".
+this Forth the return addresses are kept on the separate call stack, so the
+return stack is really just a secondary stack; it doesn't have anything to do
+with "returning".  The loop parameters of `DO`, and anything put there with
+`>R`, stay put while a word calls other words.
+
+If cxxforth is built with `CXXFORTH_DIRECT_THREADED`,
+`CXXFORTH_TOKEN_THREADED`, or `CXXFORTH_JIT` defined, this simple loop is
+only the first tier of execution, as described in **Tiered Execution** below.
+The threaded tiers keep their return addresses on the call stack too.  The
+native code tier, and any other call that does nest C++ calls, such as one
+made through `doColon()` in those builds, or a call of a translation made by
+`SAVE-CXX`, pushes an entry onto the call stack with `pushCall()` for as
+long as it runs.  So a deep recursion reports a "return stack overflow" at
+the same depth in every build, rather than crashing.
 
 ****/
 
-void doColon() {
-    auto savedNext = nextInstruction;
+// See **Profiling** below.
+Cell profiling = False;
+void profileBody(AAddr body);
 
-    auto defn = Definition::executingWord;
+void doColon();
+void doDoes();
+void doDefer();
 
-    nextInstruction = reinterpret_cast<Xt*>(defn->does);
-    while (*nextInstruction != exitXt) {
-        (*(nextInstruction++))->execute();
+// Return true if a colon definition has a C++ translation.  See **Translating
+// to C++**.
+inline bool hasCompiled(const Definition* defn) {
+#ifdef CXXFORTH_COMPILED_FILE
+    return defn->compiled != nullptr;
+#else
+    (void)defn;
+    return false;
+#endif
+}
+
+// Push an entry onto the call stack for a colon definition that is called by
+// nesting a C++ call, rather than by interpretBody()'s loop, so the depth of
+// those calls is limited the same way.  popCall() removes it.  The entry is
+// never used as a return address, so without runtime checks there's no point.
+inline void pushCall(const char* name) {
+#ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
+    (void)name;
+#else
+    requireCallStackAvailable(name);
+    *(++callTop) = nextInstruction;
+#endif
+}
+
+inline void popCall() {
+#ifndef CXXFORTH_SKIP_RUNTIME_CHECKS
+    --callTop;
+#endif
+}
+
+// Execute a colon definition's C++ translation, if it has one.  Returns false
+// if it doesn't.
+inline bool runCompiled(const Definition* defn) {
+#ifdef CXXFORTH_COMPILED_FILE
+    if (hasCompiled(defn)) {
+        pushCall(defn->name.c_str());
+        defn->compiled();
+        popCall();
+        return true;
+    }
+#endif
+    (void)defn;
+    return false;
+}
+
+// Execute the instructions starting at body until its EXIT, including those
+// of the colon definitions and DOES> words it calls.
+void interpretBody(AAddr body) {
+    if (profiling) {
+        profileBody(body);
+        return;
+    }
+
+    auto savedNext = nextInstruction;
+    auto base = callTop;
+
+    nextInstruction = reinterpret_cast<Xt*>(body);
+    for (;;) {
+        auto xt = *(nextInstruction++);
+        if (xt == exitXt) {
+            if (callTop == base)
+                break;
+            nextInstruction = *callTop; --callTop;
+        }
+        else if (xt->code == doColon && !hasCompiled(xt)) {
+            REQUIRE_CALLSTACK_AVAILABLE(xt->name.c_str());
+            *(++callTop) = nextInstruction;
+            nextInstruction = reinterpret_cast<Xt*>(xt->does);
+        }
+        else if (xt->code == doDoes) {
+            REQUIRE_DSTACK_AVAILABLE(1, xt->name.c_str());
+            REQUIRE_CALLSTACK_AVAILABLE(xt->name.c_str());
+            push(CELL(xt->parameter));
+            *(++callTop) = nextInstruction;
+            nextInstruction = reinterpret_cast<Xt*>(xt->does);
+        }
+        else if (xt->code == doDefer) {
+            auto action = XT(*xt->parameter);
+            if (action->code == doColon && !hasCompiled(action)) {
+                REQUIRE_CALLSTACK_AVAILABLE(action->name.c_str());
+                *(++callTop) = nextInstruction;
+                nextInstruction = reinterpret_cast<Xt*>(action->does);
+            }
+            else {
+                action->execute();
+            }
+        }
+        else {
+            xt->execute();
+        }
     }
 
     nextInstruction = savedNext;
 }
 
-/****
+#ifndef CXXFORTH_TIERED
 
-----
+void doColon() {
+    auto defn = Definition::executingWord;
+    if (!runCompiled(defn))
+        interpretBody(defn->does);
+}
 
-Compilation
------------
+#endif
 
-Now that we know how the inner interpreter works, I can define the words that
-compile definitions to be executed by that interpreter.
+/****
 
-The kernel provides three words that can add a word to the dictionary:
-`CREATE`, `:`, and `:NONAME`.  Each of them constructs a `Definition`, fills in
-its `name`, `code`, `parameter`, and `does` field appropriately, and then adds
-it to the `definitions` list.
+### Profiling
 
-`:` and `:NONAME` then put the interpreter into compilation mode.  While in
-compilation mode, the interpreter will add the XT's of non-immediate words to
-the current definition.  This continues until the `;` word ends the definition.
+The superinstructions that help one program may be useless for another.  So
+if the non-standard `PROFILING` variable is set to a non-zero value,
+`interpretBody()` runs a slower loop, `profileBody()`, which counts how many
+times each sequence of two or three instructions is executed.  Only the
+sequences that could be replaced by a single superinstruction are counted.
+Those are primitives, `CREATE`d words, and `DOES>` words, that don't take
+inline operands, branch, or exit.
 
-The word `DOES>` can be used after `CREATE` to define execution semantics for
-that word.  As with `:`, this puts the interpreter into compilation state until
-`:` is encountered.
+After a training run, `.PROFILE` prints the most frequently executed sequences
+as `FUSE` commands.  Those can be used to build cxxforth with superinstructions
+for exactly those sequences, as described in **Optimizing Definitions**.
+
+While `PROFILING` is set, the alternative inner interpreters don't translate
+anything, so that everything is counted.
 
 ****/
 
-// Return reference to the latest Definition.
-// Undefined behavior if the definitions list is empty.
-Definition& lastDefinition() {
-    return definitions.back();
-}
+void doFused();
 
-// LATEST ( -- xt )
+std::map<std::array<Xt, 3>, Cell> sequenceCounts;
+
+// PROFILING ( -- a-addr )
 //
 // Not a standard word.
 //
-// Puts the execution token of the most recently CREATEd word on the stack.
-void latest() {
-    push(CELL(&lastDefinition()));
-}
+// Variable that is non-zero if executed instruction sequences are being
+// counted.
+void profilingAddress() {
+    REQUIRE_DSTACK_AVAILABLE(1, "PROFILING");
+    push(CELL(&profiling));
+}
+
+// Return true if an instruction may be part of a superinstruction.
+bool isFusable(Xt xt) {
+    return xt != exitXt && xt != doLiteralXt && xt != branchXt && xt != zbranchXt
+        && xt != litPlusXt && xt != litEqualsXt && xt != dupZbranchXt && xt != setDoesXt
+        && xt != tailCallXt && xt != qdoXt && xt != loopXt && xt != plusLoopXt
+        && xt != nzbranchXt && xt != equalsBranchXt && xt != notEqualsBranchXt
+        && xt != lessBranchXt && xt != greaterBranchXt
+        && xt != localFetchXt && xt != localStoreXt && xt != localsXt
+        && xt->code != doColon && xt->code != doFused;
+}
+
+// Like interpretBody(), but count the executed instruction sequences.
+void profileBody(AAddr body) {
+    auto savedNext = nextInstruction;
+    Xt previous[2] = {nullptr, nullptr};
 
-// STATE ( -- a-addr )
-void state() {
-    REQUIRE_DSTACK_AVAILABLE(1, "STATE");
-    push(CELL(&isCompiling));
-}
+    nextInstruction = reinterpret_cast<Xt*>(body);
+    while (*nextInstruction != exitXt) {
+        auto address = nextInstruction;
+        auto xt = *(nextInstruction++);
+        if (isFusable(xt)) {
+            if (previous[1] != nullptr)
+                ++sequenceCounts[{{previous[1], xt, nullptr}}];
+            if (previous[0] != nullptr)
+                ++sequenceCounts[{{previous[0], previous[1], xt}}];
+            previous[0] = previous[1];
+            previous[1] = xt;
+        }
+        else {
+            previous[0] = previous[1] = nullptr;
+        }
 
-void doCreate() {
-    auto defn = Definition::executingWord;
-    REQUIRE_DSTACK_AVAILABLE(1, defn->name.c_str());
-    push(CELL(defn->parameter));
-}
+        xt->execute();
 
-// CREATE ( "<spaces>name" -- )  Execution: ( -- a-addr )
+        if (nextInstruction != address + 1)
+            previous[0] = previous[1] = nullptr;
+    }
+
+    nextInstruction = savedNext;
+}
+
+/****
+
+Tiered Execution
+----------------
+
+The direct-threaded and token-threaded inner interpreters and the native code
+compiler described below all translate a definition into a faster form before
+running it.  But most definitions, including most of those built into
+cxxforth, are executed only a few times, if ever, and translating those is a
+waste of time and space.
+
+So in those builds, `doColon()` uses `interpretUntilHot()`, which counts the
+number of times each definition is called in its `calls` field, and interprets
+it until the count reaches `tierThreshold`.  Then `runTranslation()`
+translates the definition and stores a pointer to the translation in the
+definition, so all later calls use it.  Like `interpretBody()`,
+`interpretUntilHot()` runs the calls of other definitions that are still being
+interpreted in its own loop, so a deep recursion doesn't nest C++ calls before
+it becomes hot.  It keeps the definition that each of those calls returns to in
+`callers`, an array beside the call stack, so that a `THROW` past it has
+nothing to clean up.
+
+A definition that is called once but runs a long loop is just as hot as one
+that is called many times, so `interpretUntilHot()` also counts each backward
+branch.  If the count reaches the threshold in the middle of the loop, it stops
+interpreting, and `runTranslation()` continues at the equivalent place in the
+translated code.  (This is known as _on-stack replacement_, though it is easy
+here, because the interpreter has no state other than the instruction
+pointer.)  A `(tail)` instruction counts as a call of the word it continues
+with, and from then on `interpretUntilHot()` counts and resumes that word
+instead.
+Because that pointer is the only thing that changes, a definition's `code`
+field is always `doColon`, and there is never a moment when the definition is
+half-translated.
+
+A definition called from translated code is translated right away, because it
+is evidently being called from something that is hot.
+
+`tierThreshold` starts with the value of the macro `CXXFORTH_TIER_THRESHOLD`,
+and can be changed with the non-standard `TIER-THRESHOLD` variable.  Setting
+it to zero translates each definition before its first call, and in the
+native code build, it makes `;` translate each new definition immediately.
+The `.TIERS` word shows the count for each definition, and whether it has been
+translated.
+
+If the optimizer has worked out a definition's stack effect, as described in
+**Stack Effects**, then none of its instructions can underflow or overflow
+the data stack, as long as the stack holds at least `effect.in` cells when it
+is called, and has room for `effect.peak` more.  So those definitions are
+translated both with and without the data stack checks, and `doColon()` calls
+`canRunUnchecked()` to check those two conditions and decide which
+translation to run.  If they don't hold, the checked translation runs, and
+reports the error at the same place, with the same message, as it would have
+otherwise.  For an on-stack replacement, `canRunUnchecked()` works out what
+the depth was at entry from the depth where execution continues.  An unchecked
+translation calls the unchecked translations of the words it calls, because
+those must have known stack effects too, and whatever stack they need has
+already been checked.
+
+A definition followed by the non-standard word `UNCHECKED` always runs its
+unchecked translation, even if its stack effect isn't known, and whatever the
+stack holds, so a profiled and debugged hot word can lose its checks without
+building a separate executable with `CXXFORTH_SKIP_RUNTIME_CHECKS`.  Code with
+checks calls such a word through `doColon()`, or in native code through its
+unchecked translation, rather than running the word's checked translation.
+Code without checks calls a definition that has no unchecked translation
+through `doColon()` too, so the words it calls keep their checks.  So does an
+`UNCHECKED` word whose own stack effect isn't known when it calls a word whose
+effect is: nothing has made sure the stack satisfies that effect, so
+`doColon()` has to check it before running the unchecked translation.  (The
+native code calls the checked translation instead.)  Only the data stack
+checks of the translated definition itself are left out.  A copy of it
+inlined into another definition is checked like the rest of that definition,
+and the primitives it executes the usual way check their arguments as always.
+
+In the standard build, which only interprets definitions, the checks are made
+by the primitives themselves, and there is no unchecked code for an
+`UNCHECKED` word to run.  So there `UNCHECKED` does nothing, and `SEE` doesn't
+show it; use `CXXFORTH_SKIP_RUNTIME_CHECKS` or one of the other builds.
+
+****/
+
+#ifdef CXXFORTH_TIERED
+
+Cell tierThreshold = CXXFORTH_TIER_THRESHOLD;
+
+// TIER-THRESHOLD ( -- a-addr )
+//
+// Not a standard word.
+//
+// Variable containing the number of calls after which a definition is
+// translated.
+void tierThresholdAddress() {
+    REQUIRE_DSTACK_AVAILABLE(1, "TIER-THRESHOLD");
+    push(CELL(&tierThreshold));
+}
+
+// Return true if a definition has been translated, and run its translation,
+// starting at the instruction at resume, until it exits.  Each tier defines
+// these.
+bool hasTranslation(const Definition* defn);
+void runTranslation(const Definition* defn, AAddr resume);
+
+// The definition that each return address on the call stack returns to, for
+// the calls that interpretUntilHot() runs in its own loop.  It is a plain
+// array beside the call stack, rather than something that owns memory,
+// because a THROW can jump past interpretUntilHot(), and CATCH discards its
+// entries just by restoring callTop.
+const Definition* callers[CXXFORTH_CALLSTACK_COUNT];
+
+// Interpret a definition until it exits, or until it becomes hot, and then
+// continue in its translation.  Like interpretBody(), it runs calls of
+// definitions that haven't been translated, and aren't about to be, in its own
+// loop, keeping their return addresses on the call stack.
+void interpretUntilHot(const Definition* defn) {
+    if (profiling) {
+        profileBody(defn->does);
+        return;
+    }
+
+    if (++defn->calls >= tierThreshold) {
+        runTranslation(defn, defn->does);
+        return;
+    }
+
+    auto savedNext = nextInstruction;
+    auto base = callTop;
+
+    nextInstruction = reinterpret_cast<Xt*>(defn->does);
+    for (;;) {
+        auto address = nextInstruction;
+        auto xt = *(nextInstruction++);
+        if (xt == exitXt) {
+            if (callTop == base)
+                break;
+            defn = callers[callTop - callStack];
+            nextInstruction = *callTop; --callTop;
+            continue;
+        }
+
+        auto callee = xt->code == doDefer ? XT(*xt->parameter) : xt;
+        if (callee->code == doColon && !hasCompiled(callee) && !hasTranslation(callee)
+            && callee->calls + 1 < tierThreshold) {
+            REQUIRE_CALLSTACK_AVAILABLE(callee->name.c_str());
+            ++callee->calls;
+            *(++callTop) = nextInstruction;
+            callers[callTop - callStack] = defn;
+            defn = callee;
+            nextInstruction = reinterpret_cast<Xt*>(defn->does);
+            continue;
+        }
+
+        xt->execute();
+        AAddr resume = nullptr;
+        if (xt == tailCallXt) {
+            defn = *(address + 1);
+            if (++defn->calls >= tierThreshold)
+                resume = defn->does;
+        }
+        else if (nextInstruction <= address && ++defn->calls >= tierThreshold) {
+            resume = AADDR(nextInstruction);
+        }
+
+        if (resume != nullptr) {
+            // Finish this definition in its translation, and return from it.
+            runTranslation(defn, resume);
+            if (callTop == base)
+                break;
+            defn = callers[callTop - callStack];
+            nextInstruction = *callTop; --callTop;
+        }
+    }
+
+    nextInstruction = savedNext;
+}
+
+// The tiers' doColon().  The call counts against the call stack, as the
+// translations may call one another through doColon().
+void doColon() {
+    auto defn = Definition::executingWord;
+    if (runCompiled(defn))
+        return;
+    pushCall(defn->name.c_str());
+    if (hasTranslation(defn))
+        runTranslation(defn, defn->does);
+    else
+        interpretUntilHot(defn);
+    popCall();
+}
+
+// Return true if a definition is translated without data stack checks.  (If
+// runtime checks are disabled, there is no point.)
+bool hasUncheckedTranslation(const Definition* defn) {
+#ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
+    (void)defn;
+    return false;
+#else
+    return defn->effect.known || defn->isUnchecked();
+#endif
+}
+
+// Return true if the stack effect of a definition's unchecked translation,
+// if it has one, covers the effects of the words it calls.  That's not so for
+// an UNCHECKED word whose stack effect isn't known.
+inline bool coversCallees(const Definition* defn) {
+    return !(defn->isUnchecked() && !defn->effect.known && hasUncheckedTranslation(defn));
+}
+
+// Return true if translated code, with or without data stack checks, can run
+// callee's translation of the same kind directly, rather than through
+// doColon().  covered is coversCallees() of the caller.
+inline bool canCallDirectly(const Definition* callee, bool checked, bool covered) {
+    if (checked)
+        return !(callee->isUnchecked() && hasUncheckedTranslation(callee));
+    return hasUncheckedTranslation(callee) && (covered || callee->isUnchecked());
+}
+
+bool stackDepthAt(AAddr entry, AAddr address, SCell& depth);
+
+// Return true if the data stack satisfies a definition's stack effect, so its
+// unchecked translation can be run, starting at the instruction at resume.
+bool canRunUnchecked(const Definition* defn, AAddr resume) {
+    if (!hasUncheckedTranslation(defn))
+        return false;
+    if (defn->isUnchecked())
+        return true;
+    SCell depth = 0;
+    if (resume != defn->does && !stackDepthAt(defn->does, resume, depth))
+        return false;
+    auto& effect = defn->effect;
+    return dStackDepth() - depth >= static_cast<SCell>(effect.in)
+        && (!needsAvailableCheck(effect.peak)
+            || dStackLimit - dTop > static_cast<SCell>(effect.peak) - depth);
+}
+
+#endif
+
+void optimizeDefinition(Definition& defn);
+
+#ifdef CXXFORTH_JIT
+const NativeWord* nativeCode(const Definition* defn, bool checked);
+#endif
+
+/****
+
+----
+
+Compilation
+-----------
+
+Now that we know how the inner interpreter works, I can define the words that
+compile definitions to be executed by that interpreter.
+
+The kernel provides three words that can add a word to the dictionary:
+`CREATE`, `:`, and `:NONAME`.  Each of them constructs a `Definition`, fills in
+its `name`, `code`, `parameter`, and `does` field appropriately, and then adds
+it to the `definitions` list.
+
+`:` and `:NONAME` then put the interpreter into compilation mode.  While in
+compilation mode, the interpreter will add the XT's of non-immediate words to
+the current definition.  This continues until the `;` word ends the definition.
+
+The word `DOES>` can be used after `CREATE` to define execution semantics for
+that word.  As with `:`, this puts the interpreter into compilation state until
+`:` is encountered.
+
+****/
+
+// Return reference to the latest Definition.
+// Undefined behavior if the definitions list is empty.
+Definition& lastDefinition() {
+    return definitions.back();
+}
+
+// LATEST ( -- xt )
+//
+// Not a standard word.
+//
+// Puts the execution token of the most recently CREATEd word on the stack.
+void latest() {
+    push(CELL(&lastDefinition()));
+}
+
+// STATE ( -- a-addr )
+void state() {
+    REQUIRE_DSTACK_AVAILABLE(1, "STATE");
+    push(CELL(&isCompiling));
+}
+
+void doCreate() {
+    auto defn = Definition::executingWord;
+    REQUIRE_DSTACK_AVAILABLE(1, defn->name.c_str());
+    push(CELL(defn->parameter));
+}
+
+// CREATE ( "<spaces>name" -- )  Execution: ( -- a-addr )
 void create() {
     alignDataPointer();
 
@@ -1668,7 +2673,7 @@ void create() {
     auto length = SIZE_T(*dTop); pop();
     auto caddr = CHARPTR(*dTop); pop();
 
-    RUNTIME_ERROR_IF(length < 1, "CREATE: could not parse name");
+    RUNTIME_ERROR_IF(length < 1, "CREATE: could not parse name", ThrowZeroLengthName);
 
     Definition defn;
     defn.code = doCreate;
@@ -1677,10 +2682,16 @@ void create() {
     definitions.emplace_back(std::move(defn));
 }
 
+// See **Locals** below.
+void endLocals();
+void compileUnlocals();
+void compileExit();
+
 // : ( C: "<spaces>name" -- colon-sys )
 void colon() {
     create();
     isCompiling = true;
+    endLocals();
 
     auto& latest = lastDefinition();
     latest.code = doColon;
@@ -1697,6 +2708,7 @@ void noname() {
     definitions.emplace_back(std::move(defn));
 
     isCompiling = true;
+    endLocals();
     latest();
 }
 
@@ -1705,18 +2717,322 @@ void doDoes() {
     doColon();
 }
 
-void setDoes() {
+StackEffect stackEffectAt(AAddr entry);
+
+// Make the latest definition a DOES> word whose instructions start at body.
+void setDoesBody(AAddr body) {
     auto& latest = lastDefinition();
     latest.code = doDoes;
-    latest.does = AADDR(nextInstruction) + 1;
+    latest.does = body;
+    latest.effect = stackEffectAt(body);
+#ifdef CXXFORTH_DIRECT_THREADED
+    latest.threaded = nullptr;
+    latest.uncheckedThreaded = nullptr;
+#endif
+#ifdef CXXFORTH_TOKEN_THREADED
+    latest.tokens = nullptr;
+#endif
+#ifdef CXXFORTH_JIT
+    latest.native = nullptr;
+    latest.uncheckedNative = nullptr;
+#endif
+#ifdef CXXFORTH_TIERED
+    latest.calls = 0;
+#endif
+}
+
+void setDoes() {
+    setDoesBody(AADDR(nextInstruction) + 1);
 }
 
 // DOES>
 void does() {
+    compileUnlocals();
+    endLocals();
     data(CELL(setDoesXt));
     data(CELL(exitXt));
 }
 
+/****
+
+`CONSTANT`, `VALUE`, and `DEFER` could be defined in Forth with
+`CREATE...DOES>`, and in earlier versions of cxxforth they were.  But then
+every use of a constant goes through `doDoes()`, which pushes the data field
+address and then runs `@` and `EXIT` in the inner interpreter, and every use of
+a deferred word runs three instructions to get to the word it really wants to
+execute.
+
+So these defining words are in C++, and each gives the new word its own code
+field that does the whole job in one step.  A variable doesn't need one of
+these: its code field is `doCreate()`, which already does everything a
+variable needs to do.
+
+`doConstant()` and `doValue()` do the same thing, but they are different
+functions so that the optimizer and the native code compiler can tell
+constants, whose values never change, from values, which can be changed with
+`TO`.
+
+****/
+
+void doConstant() {
+    auto defn = Definition::executingWord;
+    REQUIRE_DSTACK_AVAILABLE(1, defn->name.c_str());
+    push(*defn->parameter);
+}
+
+void doValue() {
+    auto defn = Definition::executingWord;
+    REQUIRE_DSTACK_AVAILABLE(1, defn->name.c_str());
+    push(*defn->parameter);
+}
+
+void doDefer() {
+    auto defn = Definition::executingWord;
+    XT(*defn->parameter)->execute();
+}
+
+// CONSTANT ( x "<spaces>name" -- )  Execution: ( -- x )
+void constant() {
+    REQUIRE_DSTACK_DEPTH(1, "CONSTANT");
+    create();
+    comma();
+    lastDefinition().code = doConstant;
+}
+
+// VALUE ( x "<spaces>name" -- )  Execution: ( -- x )
+void value() {
+    REQUIRE_DSTACK_DEPTH(1, "VALUE");
+    create();
+    comma();
+    lastDefinition().code = doValue;
+}
+
+// DEFER ( "<spaces>name" -- )  Execution: ( i*x -- j*x )
+void defer() {
+    create();
+    data(CELL(abortXt));
+    lastDefinition().code = doDefer;
+}
+
+/****
+
+The fields of a structure, described in **Structures** below, are treated the
+same way.  A field defined by `+FIELD` gets the `doField()` code field, which
+adds the field's offset, kept in its data field, to the address on top of the
+stack.
+
+****/
+
+void doField() {
+    auto defn = Definition::executingWord;
+    REQUIRE_DSTACK_DEPTH(1, defn->name.c_str());
+    *dTop += *defn->parameter;
+}
+
+// +FIELD ( n1 n2 "<spaces>name" -- n3 )  Execution: ( addr1 -- addr2 )
+void plusField() {
+    REQUIRE_DSTACK_DEPTH(2, "+FIELD");
+    auto size = *dTop; pop();
+    auto offset = *dTop;
+    create();
+    data(offset);
+    lastDefinition().code = doField;
+    *dTop = offset + size;
+}
+
+/****
+
+### Locals
+
+A long Forth definition can spend much of its time, and much of its reader's
+patience, getting things to the top of the stack with `ROT`, `PICK`, and
+`>R`.  Forth 2012 lets a colon definition declare _locals_ instead:
+
+    : hypot2 {: a b | sum -- n :}  a a *  to sum  b b *  sum + ;
+
+`{:` takes the names up to `:}`.  The locals before the `|` are initialized
+from the data stack, the last one from the top, and those after it start at
+zero.  Anything between `--` and `:}` is a comment.  Using a local's name
+pushes its value, and `TO` stores a new value into it.
+
+At run time, the locals live in a frame on the return stack.  `{:` compiles
+`(lit) 0` for each local after `|`, followed by `(locals) n`, which pushes the
+current `localFrame` pointer onto the return stack and then moves the top `n`
+data stack cells above it, pointing `localFrame` at the first of them.  Then
+`(local@) i` and `(local!) i` each read or write `localFrame[i]` in a single
+instruction, no matter what `DO` loops and `>R` have put on the return stack
+since.  Before each `EXIT` in the definition, including the one compiled by
+`;`, and before the `(does)` compiled by `DOES>`, `(unlocals)` drops the frame
+and restores the previous frame pointer.
+Because the frame pointer is saved in the frame, a definition with locals can
+call another one, or itself.
+
+While the definition is being compiled, each local's name is an immediate
+word in `localDefinitions`, which `FIND` searches before the dictionary, and
+executing one of them compiles `(local@)`.  The names are forgotten at `;` or
+`DOES>`, because a `DOES>` part runs long after the frame is gone.
+
+****/
+
+// The greatest number of locals a definition can declare.
+constexpr size_t LocalsLimit = 64;
+
+// The locals of the definition being compiled.  Space for all of them is
+// reserved up front, so their addresses don't change.
+std::vector<Definition> localDefinitions;
+
+// Create a frame for n locals, taking their values from the data stack.
+void enterLocals(Cell n) {
+    REQUIRE_DSTACK_DEPTH(n, "(locals)");
+    REQUIRE_RSTACK_AVAILABLE(n + 1, "(locals)");
+    *(++rTop) = CELL(localFrame);
+    localFrame = rTop + 1;
+    std::memcpy(localFrame, dTop - n + 1, n * CellSize);
+    rTop += n;
+    dTop -= n;
+}
+
+// (locals) ( i*x -- ) ( R: -- frame i*x )
+//
+// Not a standard word.
+//
+// Creates a frame for the number of locals in the following cell.
+void locals() {
+    auto n = CELL(*nextInstruction);
+    ++nextInstruction;
+    enterLocals(n);
+}
+
+// (unlocals) ( -- ) ( R: frame i*x -- )
+//
+// Not a standard word.
+//
+// Drops the current frame of locals.
+void unlocals() {
+    rTop = localFrame - 1;
+    localFrame = AADDR(*rTop);
+    --rTop;
+}
+
+// (local@) ( -- x )
+//
+// Not a standard word.
+//
+// Pushes the value of the local whose index is in the following cell.
+void localFetch() {
+    REQUIRE_DSTACK_AVAILABLE(1, "(local@)");
+    push(localFrame[CELL(*nextInstruction)]);
+    ++nextInstruction;
+}
+
+// (local!) ( x -- )
+//
+// Not a standard word.
+//
+// Stores x into the local whose index is in the following cell.
+void localStore() {
+    REQUIRE_DSTACK_DEPTH(1, "(local!)");
+    localFrame[CELL(*nextInstruction)] = *dTop; pop();
+    ++nextInstruction;
+}
+
+// Return the index of the local whose name is defn, or -1 if it isn't a local.
+SCell localIndex(const Definition* defn) {
+    for (size_t i = 0; i < localDefinitions.size(); ++i) {
+        if (&localDefinitions[i] == defn)
+            return static_cast<SCell>(i);
+    }
+    return -1;
+}
+
+// Executed by a local's name at compile time.
+void compileLocal() {
+    data(CELL(localFetchXt));
+    data(static_cast<Cell>(localIndex(Definition::executingWord)));
+}
+
+// Forget the names of the locals.
+void endLocals() {
+    localDefinitions.clear();
+}
+
+// Compile (unlocals), if there are any locals.
+void compileUnlocals() {
+    if (!localDefinitions.empty())
+        data(CELL(unlocalsXt));
+}
+
+// Compile an EXIT, dropping the locals first if there are any.
+void compileExit() {
+    compileUnlocals();
+    data(CELL(exitXt));
+}
+
+// {: ( "<spaces>name ... :}" -- )
+void beginLocals() {
+    if (!localDefinitions.empty())
+        throw AbortException("{:: locals already declared");
+    localDefinitions.reserve(LocalsLimit);
+
+    size_t initialized = 0;
+    auto isInitialized = true;
+    auto isComment = false;
+    for (;;) {
+        bl(); word(); count();
+        auto length = SIZE_T(*dTop); pop();
+        auto caddr = CHARPTR(*dTop); pop();
+        if (length == 0)
+            throw AbortException("{:: missing :}", ThrowZeroLengthName);
+
+        auto name = string(caddr, length);
+        if (name == ":}")
+            break;
+        else if (isComment)
+            continue;
+        else if (name == "--")
+            isComment = true;
+        else if (name == "|")
+            isInitialized = false;
+        else {
+            if (localDefinitions.size() == LocalsLimit)
+                throw AbortException("{:: too many locals");
+            Definition local;
+            local.code = compileLocal;
+            local.name = name;
+            local.flags = Definition::FlagImmediate;
+            localDefinitions.emplace_back(std::move(local));
+            if (isInitialized)
+                initialized = localDefinitions.size();
+        }
+    }
+
+    if (localDefinitions.empty())
+        return;
+    for (auto i = initialized; i < localDefinitions.size(); ++i) {
+        data(CELL(doLiteralXt));
+        data(0);
+    }
+    data(CELL(localsXt));
+    data(localDefinitions.size());
+}
+
+// (TO-LOCAL) ( xt -- true | xt false )
+//
+// Not a standard word.
+//
+// If xt is the name of a local, compiles a store into that local.
+void toLocal() {
+    REQUIRE_DSTACK_DEPTH(1, "(TO-LOCAL)");
+    auto index = localIndex(XT(*dTop));
+    if (index < 0) {
+        push(False);
+        return;
+    }
+    data(CELL(localStoreXt));
+    data(static_cast<Cell>(index));
+    *dTop = True;
+}
+
 // (;) ( -- )
 //
 // Not a standard word.
@@ -1727,12 +3043,28 @@ void endOfDefinition() {
     throw AbortException("(;) should never be executed");
 }
 
+#ifdef CXXFORTH_COMPILED_FILE
+void bindCompiled(Definition& defn);
+#endif
+
 // ; ( C: colon-sys -- )
 void semicolon() {
-    data(CELL(exitXt));
+    compileExit();
+    endLocals();
     data(CELL(endOfDefinitionXt));
     isCompiling = false;
-    lastDefinition().toggleHidden();
+    auto& latest = lastDefinition();
+    if (latest.code == doColon)
+        optimizeDefinition(latest);
+    latest.toggleHidden();
+#ifdef CXXFORTH_COMPILED_FILE
+    if (latest.code == doColon)
+        bindCompiled(latest);
+#endif
+#ifdef CXXFORTH_JIT
+    if (latest.code == doColon && tierThreshold == 0)
+        nativeCode(&latest, !hasUncheckedTranslation(&latest));
+#endif
 }
 
 // IMMEDIATE ( -- )
@@ -1748,167 +3080,5756 @@ void immediate() { lastDefinition().toggleImmediate(); }
 // Toggles the hidden bit of the most recent definition.
 void hidden() { lastDefinition().toggleHidden(); }
 
+// UNCHECKED ( -- )
+//
+// Not a standard word.
+//
+// Makes the most recent definition run without data stack checks once it is
+// translated.  See **Tiered Execution**.  Does nothing in the standard build.
+void unchecked() {
+#ifdef CXXFORTH_TIERED
+    lastDefinition().flags |= Definition::FlagUnchecked;
+#endif
+}
+
+/****
+
+Next I'll define a few "special words".  They are special in that they are used
+to implement features of the inner interpreter, and are not generally used by
+Forth application code.  As a signifier of their special nature, the words'
+names start and end with with parentheses.
+
+****/
+
+// (lit) ( -- x )
+//
+// Not a standard word.
+//
+// This instruction gets the value of the next cell, puts that on the data
+// stack, and then moves the instruction pointer to the next instruction.  It
+// is used by `LITERAL` and other Forth words that need to specify a cell value
+// to put on the stack during execution.
+void doLiteral() {
+    REQUIRE_DSTACK_AVAILABLE(1, "(lit)");
+    push(CELL(*nextInstruction));
+    ++nextInstruction;
+}
+
+// (branch) ( -- )
+//
+// Not a standard word.
+//
+// Used by branching/looping constructs.  Unconditionally adds an offset to
+// `next`.  The offset is in the cell following the instruction.
+//
+// The offset is in character units, but must be a multiple of the cell size.
+// Because it's already scaled, it is added to the address as is, rather than
+// being divided by the cell size to be added to an `Xt*`.
+void branch() {
+    auto offset = reinterpret_cast<SCell>(*nextInstruction);
+    nextInstruction = reinterpret_cast<Xt*>(CADDR(nextInstruction) + offset);
+}
+
+// Continue with the instruction after the offset if condition is true, or
+// branch by the offset if it is false.
+inline void branchUnless(bool condition) {
+    if (condition)
+        ++nextInstruction;
+    else
+        branch();
+}
+
+// (zbranch) ( flag -- )
+//
+// Not a standard word.
+//
+// Used by branching/looping constructinos.  Adds an offset to `next` if the
+// top-of-stack value is zero.  The offset is in the cell following the
+// instruction.  If top-of-stack is not zero, then continue to the next
+// instruction.
+void zbranch() {
+    REQUIRE_DSTACK_DEPTH(1, "(zbranch)");
+    auto flag = *dTop; pop();
+    branchUnless(flag != False);
+}
+
+/****
+
+Counted Loops
+-------------
+
+A `DO` loop keeps its _loop-control parameters_ on the return stack: the limit,
+and above it, the current index.  So `I` is just `R@`, and `J` looks two cells
+further down, at the index of the enclosing loop.  Because this implementation
+doesn't keep return addresses on the return stack, the parameters stay
+put while the loop calls other words.
+
+`DO` compiles `(do)`, which moves the limit and the initial index from the data
+stack to the return stack.  `LOOP` compiles `(loop)`, which adds one to the
+index, and then either branches back to the start of the loop, or, if the index
+has reached the limit, removes the parameters and continues.  `+LOOP` compiles
+`(+loop)`, which adds the top of the data stack to the index, and stops when the
+index crosses the boundary between the limit minus one and the limit, in
+either direction.  `?DO` compiles `(?do)`, which skips the whole loop if the
+initial index equals the limit.
+
+`(loop)`, `(+loop)`, and `(?do)` are conditional branches, with an offset in the
+following cell, just like `(zbranch)`, so the optimizer and the alternative
+inner interpreters treat them the same way.  `LEAVE` compiles an `UNLOOP`
+followed by a `(branch)` to the end of the loop, as described with the Forth
+definitions below.
+
+****/
+
+// (do) ( n1|u1 n2|u2 -- ) ( R: -- loop-sys )
+//
+// Not a standard word.
+//
+// Start a loop with limit n1|u1 and initial index n2|u2.
+void doDo() {
+    REQUIRE_DSTACK_DEPTH(2, "DO");
+    REQUIRE_RSTACK_AVAILABLE(2, "DO");
+    rpush(*(dTop - 1));
+    rpush(*dTop);
+    dTop -= 2;
+}
+
+// (?do) ( n1|u1 n2|u2 -- ) ( R: -- | loop-sys )
+//
+// Not a standard word.
+//
+// Like (do), but if the limit equals the index, branch past the loop by the
+// offset in the following cell instead.
+void qdo() {
+    REQUIRE_DSTACK_DEPTH(2, "?DO");
+    if (*dTop == *(dTop - 1)) {
+        dTop -= 2;
+        branch();
+    }
+    else {
+        doDo();
+        ++nextInstruction;
+    }
+}
+
+// (loop) ( -- ) ( R: loop-sys1 -- | loop-sys2 )
+//
+// Not a standard word.
+//
+// Add one to the loop index.  If it's not equal to the limit, branch back by the
+// offset in the following cell.
+void loop() {
+    REQUIRE_RSTACK_DEPTH(2, "LOOP");
+    auto index = *rTop + 1;
+    if (index == *(rTop - 1)) {
+        rTop -= 2;
+        ++nextInstruction;
+    }
+    else {
+        *rTop = index;
+        branch();
+    }
+}
+
+// Return true if adding n to the loop index crosses the boundary between
+// limit - 1 and limit.
+bool loopCrossesLimit(Cell index, Cell limit, Cell n) {
+    auto x = index - limit;
+    return static_cast<SCell>((x ^ (x + n)) & (x ^ n)) < 0;
+}
+
+// (+loop) ( n -- ) ( R: loop-sys1 -- | loop-sys2 )
+//
+// Not a standard word.
+//
+// Add n to the loop index.  If it didn't cross the limit, branch back by the
+// offset in the following cell.
+void plusLoop() {
+    REQUIRE_DSTACK_DEPTH(1, "+LOOP");
+    REQUIRE_RSTACK_DEPTH(2, "+LOOP");
+    auto n = *dTop; pop();
+    auto index = *rTop;
+    if (loopCrossesLimit(index, *(rTop - 1), n)) {
+        rTop -= 2;
+        ++nextInstruction;
+    }
+    else {
+        *rTop = index + n;
+        branch();
+    }
+}
+
+// I ( -- n|u ) ( R: loop-sys -- loop-sys )
+void loopIndex() {
+    REQUIRE_RSTACK_DEPTH(2, "I");
+    REQUIRE_DSTACK_AVAILABLE(1, "I");
+    push(*rTop);
+}
+
+// J ( -- n|u ) ( R: loop-sys1 loop-sys2 -- loop-sys1 loop-sys2 )
+void outerLoopIndex() {
+    REQUIRE_RSTACK_DEPTH(4, "J");
+    REQUIRE_DSTACK_AVAILABLE(1, "J");
+    push(*(rTop - 2));
+}
+
+// UNLOOP ( -- ) ( R: loop-sys -- )
+void unloop() {
+    REQUIRE_RSTACK_DEPTH(2, "UNLOOP");
+    rTop -= 2;
+}
+
+/****
+
+Superinstructions
+-----------------
+
+Each of the following special words does the work of a short sequence of
+instructions that often appear together in definitions.  For example, `1 +`
+compiles into the three cells `(lit) 1 +`, and takes two trips through the
+inner interpreter to execute.  `(lit+) 1` does the same
+thing in two cells and one trip.
+
+These are called _superinstructions_.  Nobody has to use them directly, because
+the optimizer described in **Optimizing Definitions** below substitutes them
+for the sequences they replace when `;` completes a definition.  Those that
+replace a `(lit)` or a `(zbranch)` take the same inline operand.
+
+The most common conditions, such as `0= IF`, `= IF`, and `< UNTIL`, test a
+comparison as soon as it is made, so the comparison and the `(zbranch)` are
+replaced by one instruction, such as `(nzbranch)` or `(=branch)`, that
+branches without ever pushing the flag.  `branchComparison()`, defined with
+`decodeBody()` below, tells the alternative inner interpreters which comparison each
+of them makes.
+
+The runtime checks use the names of the words that were replaced, so the error
+messages are the same whether or not a definition has been optimized.
+
+****/
+
+// (lit+) ( n1 -- n2 )
+//
+// Not a standard word.
+//
+// Equivalent to (lit) n +, with n in the following cell.
+void litPlus() {
+    REQUIRE_DSTACK_DEPTH(1, "+");
+    *dTop += CELL(*nextInstruction);
+    ++nextInstruction;
+}
+
+// (lit=) ( x1 -- flag )
+//
+// Not a standard word.
+//
+// Equivalent to (lit) x2 =, with x2 in the following cell.
+void litEquals() {
+    REQUIRE_DSTACK_DEPTH(1, "=");
+    *dTop = *dTop == CELL(*nextInstruction) ? True : False;
+    ++nextInstruction;
+}
+
+// (dup-zbranch) ( x -- x )
+//
+// Not a standard word.
+//
+// Equivalent to DUP (zbranch) offset, with the offset in the following cell.
+void dupZbranch() {
+    REQUIRE_DSTACK_DEPTH(1, "DUP");
+    branchUnless(*dTop != False);
+}
+
+// (nzbranch) ( x -- )
+//
+// Not a standard word.
+//
+// Equivalent to 0= (zbranch) offset, with the offset in the following cell.
+// That is, it branches if x is not zero.
+void nzbranch() {
+    REQUIRE_DSTACK_DEPTH(1, "0=");
+    auto x = *dTop; pop();
+    branchUnless(x == 0);
+}
+
+// (=branch) ( x1 x2 -- )
+//
+// Not a standard word.
+//
+// Equivalent to = (zbranch) offset, with the offset in the following cell.
+void equalsBranch() {
+    REQUIRE_DSTACK_DEPTH(2, "=");
+    auto x2 = *dTop, x1 = *(dTop - 1); dTop -= 2;
+    branchUnless(x1 == x2);
+}
+
+// (<>branch) ( x1 x2 -- )
+//
+// Not a standard word.
+//
+// Equivalent to <> (zbranch) offset, with the offset in the following cell.
+void notEqualsBranch() {
+    REQUIRE_DSTACK_DEPTH(2, "<>");
+    auto x2 = *dTop, x1 = *(dTop - 1); dTop -= 2;
+    branchUnless(x1 != x2);
+}
+
+// (<branch) ( n1 n2 -- )
+//
+// Not a standard word.
+//
+// Equivalent to < (zbranch) offset, with the offset in the following cell.
+void lessBranch() {
+    REQUIRE_DSTACK_DEPTH(2, "<");
+    auto n2 = static_cast<SCell>(*dTop), n1 = static_cast<SCell>(*(dTop - 1)); dTop -= 2;
+    branchUnless(n1 < n2);
+}
+
+// (>branch) ( n1 n2 -- )
+//
+// Not a standard word.
+//
+// Equivalent to > (zbranch) offset, with the offset in the following cell.
+void greaterBranch() {
+    REQUIRE_DSTACK_DEPTH(2, ">");
+    auto n2 = static_cast<SCell>(*dTop), n1 = static_cast<SCell>(*(dTop - 1)); dTop -= 2;
+    branchUnless(n1 > n2);
+}
+
+// (over-over) ( x1 x2 -- x1 x2 x1 x2 )
+//
+// Not a standard word.
+//
+// Equivalent to OVER OVER.
+void overOver() {
+    REQUIRE_DSTACK_DEPTH(2, "OVER");
+    REQUIRE_DSTACK_AVAILABLE(2, "OVER");
+    push(*(dTop - 1));
+    push(*(dTop - 1));
+}
+
+// (swap-drop) ( x1 x2 -- x2 )
+//
+// Not a standard word.
+//
+// Equivalent to SWAP DROP.
+void swapDrop() {
+    REQUIRE_DSTACK_DEPTH(2, "SWAP");
+    auto x2 = *dTop; pop();
+    *dTop = x2;
+}
+
+// (@+) ( n1 a-addr -- n2 )
+//
+// Not a standard word.
+//
+// Equivalent to @ +.
+void fetchPlus() {
+    REQUIRE_DSTACK_DEPTH(1, "@");
+    auto aaddr = AADDR(*dTop);
+    REQUIRE_ALIGNED(aaddr, "@");
+    REQUIRE_DSTACK_DEPTH(2, "+");
+    pop();
+    *dTop += *aaddr;
+}
+
+/****
+
+Tail Calls
+----------
+
+When the last thing a colon definition does before `EXIT` is call another colon
+definition, there is no need to come back to it.  The optimizer described in
+**Optimizing Definitions** replaces such a call with `(tail)`, followed by the
+XT of the called word.  Rather than calling `doColon()`, `(tail)` just sets
+`nextInstruction` to the first instruction of the called word, so the loop in
+`interpretBody()` carries on with that word's instructions, and ends when it
+reaches that word's `EXIT`.
+
+So a word that calls itself with `RECURSE` as its last action runs in
+constant space, like a loop, without pushing anything onto the call stack, and
+so do words that pass control to each other in a chain.
+
+****/
+
+// (tail) ( -- )
+//
+// Not a standard word.
+//
+// Continue with the instructions of the colon definition whose XT is in the
+// following cell, rather than returning to this one.
+void tailCall() {
+    auto defn = *nextInstruction;
+    nextInstruction = reinterpret_cast<Xt*>(defn->does);
+}
+
+/****
+
+Decoding Definitions
+--------------------
+
+Several parts of the system need to look at the instructions of a colon
+definition as instructions, rather than as a sequence of cells.  A body is
+mostly a sequence of XTs, but `(lit)`, `(branch)`, and `(zbranch)` are followed
+by an inline operand cell, and words like `SLITERAL` store raw data in the
+middle of a definition and branch around it.
+
+`decodeBody()` walks a definition starting at a given entry point, following
+every path the inner interpreter could take, and returns the reachable
+instructions sorted by address.  Cells that can't be reached from the entry
+point (inline string data, or the `DOES>` part of a defining word) are not
+included, unless `includeDoes` is true, in which case the `DOES>` parts are
+decoded too.  Each path ends at an `EXIT` or a `(tail)`.
+
+****/
+
+struct Instruction {
+    AAddr address;            // location of the instruction in data space
+    Xt    xt;                 // the word to be executed
+    Cell  operand = 0;        // inline operand, if any
+    AAddr target  = nullptr;  // destination of a branch, if any
+    AAddr end     = nullptr;  // address following the instruction
+    bool  follows = false;    // comes from the same cells as the one before
+
+    bool hasOperand() const {
+        return xt == doLiteralXt || xt == litPlusXt || xt == litEqualsXt || xt == tailCallXt
+            || xt == localFetchXt || xt == localStoreXt || xt == localsXt || isBranch();
+    }
+    bool isBranch() const {
+        return xt == branchXt || xt == zbranchXt || xt == dupZbranchXt
+            || xt == qdoXt || xt == loopXt || xt == plusLoopXt
+            || xt == nzbranchXt || xt == equalsBranchXt || xt == notEqualsBranchXt
+            || xt == lessBranchXt || xt == greaterBranchXt;
+    }
+
+    // Return the number of cells the instruction occupies in data space.
+    size_t size() const     { return hasOperand() ? 2 : 1; }
+};
+
+// The comparison primitives that (nzbranch), (=branch), and the others
+// replace, found when the kernel is defined.
+std::unordered_map<Xt, Xt> branchComparisons;
+
+// If xt is a superinstruction that makes a comparison and then branches like
+// (zbranch), return the XT of the comparison primitive.  Otherwise return
+// nullptr.
+Xt branchComparison(Xt xt) {
+    auto found = branchComparisons.find(xt);
+    return found == branchComparisons.end() ? nullptr : found->second;
+}
+
+std::vector<Instruction> decodeBody(AAddr entry, bool includeDoes = false) {
+    std::vector<Instruction> instructions;
+    std::set<AAddr> visited;
+    std::vector<AAddr> pending{entry};
+
+    while (!pending.empty()) {
+        auto address = pending.back(); pending.pop_back();
+        while (visited.insert(address).second) {
+            Instruction instruction{address, XT(*address)};
+            if (instruction.hasOperand())
+                instruction.operand = *(address + 1);
+            if (instruction.isBranch()) {
+                auto offset = static_cast<SCell>(instruction.operand);
+                instruction.target = address + 1 + offset / static_cast<SCell>(CellSize);
+                pending.push_back(instruction.target);
+            }
+            if (includeDoes && instruction.xt == setDoesXt)
+                pending.push_back(address + 2);
+            instruction.end = address + instruction.size();
+            instructions.push_back(instruction);
+
+            if (instruction.xt == exitXt || instruction.xt == branchXt || instruction.xt == tailCallXt)
+                break;
+            address += instruction.size();
+        }
+    }
+
+    std::sort(instructions.begin(), instructions.end(), [](auto& a, auto& b) {
+        return a.address < b.address;
+    });
+    return instructions;
+}
+
+/****
+
+The threaded inner interpreters described below give the following primitives
+their own implementations, rather than calling them through their `code`
+fields.
+
+They also handle calls to other colon definitions themselves, keeping the
+return addresses on the call stack along with those of `interpretBody()`, so
+that a call tree runs in one loop however deep it is, and keep the top of the
+data stack in a local variable.
+
+****/
+
+// Push a threaded interpreter's return address onto the call stack, for a
+// call of the named word.
+template<typename Address>
+inline void pushReturn(Address address, const char* name) {
+    REQUIRE_CALLSTACK_AVAILABLE(name);
+    *(++callTop) = static_cast<Xt*>(const_cast<void*>(static_cast<const void*>(address)));
+}
+
+// Pop a threaded interpreter's return address off the call stack.
+template<typename Address>
+inline Address popReturn() {
+    auto address = reinterpret_cast<Address>(*callTop); --callTop;
+    return address;
+}
+
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+
+
+#define THREADED_PRIMITIVES(X) \
+    X(drop)       X(dup)        X(swap)       X(pick)       X(roll)      \
+    X(toR)        X(rFrom)      X(rFetch)     X(store)      X(fetch)     \
+    X(cstore)     X(cfetch)     X(cells)      X(plus)       X(minus)     \
+    X(star)       X(slash)      X(slashMod)   X(bitwiseAnd) X(bitwiseOr) \
+    X(bitwiseXor) X(lshift)     X(rshift)     X(equals)     X(lessThan)  \
+    X(uLessThan)  X(overOver)   X(swapDrop)   X(fetchPlus)  X(over)      \
+    X(rot)        X(nip)        X(tuck)       X(twoDrop)    X(twoDup)    \
+    X(twoOver)    X(twoSwap)    X(questionDup) X(plusStore) X(onePlus)   \
+    X(oneMinus)   X(twoStar)    X(twoSlash)   X(negate)     X(invert)    \
+    X(absValue)   X(minimum)    X(maximum)    X(greaterThan) X(notEquals) \
+    X(zeroLess)   X(zeroEquals) X(doDo)       X(loopIndex)  X(outerLoopIndex) \
+    X(unloop)
+
+#if defined(CXXFORTH_DIRECT_THREADED) || defined(CXXFORTH_TOKEN_THREADED)
+
+/****
+
+### Caching the Top of the Stack
+
+Nearly every primitive reads the top item of the data stack, and most of them
+replace it, so the C++ primitives spend much of their time loading and storing
+`*dTop`.  The threaded inner interpreters avoid most of that by keeping the
+top item in a local variable, which the compiler can keep in a register.  The
+interpreter's `CachedStack` has its own copy of the stack pointer, `sp`, and
+the value of the top item, `tos`.  The memory at `sp` is not kept up to date;
+only the items below the top are.
+
+So `+` just adds the second item to `tos` and decrements `sp`, one load and no
+stores, rather than two loads and a store.
+
+The function template `cached()` executes a primitive on a `CachedStack`.
+By default, it _spills_ the cache, storing `tos` at `sp` and `sp` into `dTop`,
+calls the primitive, and then _fills_ the cache again.  Each primitive that
+is executed often has an overload that works on the cache directly.  The
+inner interpreters also spill the cache before executing any other word, and
+before returning.
+
+The primitive is passed as an empty `Primitive<fn>` argument, and the
+`CachedStack` has a template parameter, `Checked`, which says whether its
+`requireDepth()` and `requireAvailable()` do anything.  So each overload can
+be instantiated both with and without the data stack checks, for the
+unchecked translations described in **Tiered Execution**.  (A function
+template can't be partially specialized, which is why these are overloads.)
+
+The data stack array has an extra cell below the bottom of the stack, so that
+it is safe to spill and fill the cache even when the stack is empty.
+
+The checks throw their exceptions by calling `throwCheckFailure()`, as
+described in **Runtime Safety Checks**.
+
+****/
+
+template<bool Checked>
+struct CachedStack {
+    AAddr sp;   // copy of dTop
+    Cell  tos;  // value of the top item
+
+    void spill() { *sp = tos; dTop = sp; }
+    void fill()  { sp = dTop; tos = *sp; }
+
+    void push(Cell x) { *sp++ = tos; tos = x; }
+    void pop()        { tos = *--sp; }
+
+    // The second item, and the ones below it.
+    Cell& operator[](size_t n) const { return *(sp - n); }
+
+#ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
+    void requireDepth(size_t, const char*) const     {}
+    void requireAvailable(size_t, const char*) const {}
+#else
+    void requireDepth(size_t n, const char* name) const {
+        if (Checked && sp - dStack + 1 < static_cast<ptrdiff_t>(n))
+            throwCheckFailure(name, ": stack underflow", ThrowStackUnderflow);
+    }
+    void requireAvailable(size_t n, const char* name) const {
+        if (Checked && needsAvailableCheck(n) && (sp + n) >= dStackLimit)
+            throwCheckFailure(name, ": stack overflow", ThrowStackOverflow);
+    }
+#endif
+};
+
+template<Code fn>
+struct Primitive {};
+
+template<Code fn, bool Checked>
+void cached(Primitive<fn>, CachedStack<Checked>& s) {
+    s.spill();
+    fn();
+    s.fill();
+}
+
+template<bool Checked> void cached(Primitive<drop>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "DROP");
+    s.pop();
+}
+
+template<bool Checked> void cached(Primitive<dup>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "DUP");
+    s.requireAvailable(1, "DUP");
+    s.push(s.tos);
+}
+
+template<bool Checked> void cached(Primitive<swap>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "SWAP");
+    std::swap(s.tos, s[1]);
+}
+
+template<bool Checked> void cached(Primitive<pick>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "PICK");
+    auto index = s.tos;
+    s.requireDepth(index + 2, "PICK");
+    s.tos = s[index + 1];
+}
+
+template<bool Checked> void cached(Primitive<toR>, CachedStack<Checked>& s) {
+    s.requireDepth(1, ">R");
+    REQUIRE_RSTACK_AVAILABLE(1, ">R");
+    rpush(s.tos); s.pop();
+}
+
+template<bool Checked> void cached(Primitive<rFrom>, CachedStack<Checked>& s) {
+    REQUIRE_RSTACK_DEPTH(1, "R>");
+    s.requireAvailable(1, "R>");
+    s.push(*rTop); rpop();
+}
+
+template<bool Checked> void cached(Primitive<rFetch>, CachedStack<Checked>& s) {
+    REQUIRE_RSTACK_DEPTH(1, "R@");
+    s.requireAvailable(1, "R@");
+    s.push(*rTop);
+}
+
+template<bool Checked> void cached(Primitive<store>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "!");
+    auto aaddr = AADDR(s.tos);
+    REQUIRE_ALIGNED(aaddr, "!");
+    *aaddr = s[1];
+    s.sp -= 2; s.tos = *s.sp;
+}
+
+template<bool Checked> void cached(Primitive<fetch>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "@");
+    auto aaddr = AADDR(s.tos);
+    REQUIRE_ALIGNED(aaddr, "@");
+    s.tos = *aaddr;
+}
+
+template<bool Checked> void cached(Primitive<cstore>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "C!");
+    *CADDR(s.tos) = static_cast<Char>(s[1]);
+    s.sp -= 2; s.tos = *s.sp;
+}
+
+template<bool Checked> void cached(Primitive<cfetch>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "C@");
+    s.tos = static_cast<Cell>(*CADDR(s.tos));
+}
+
+template<bool Checked> void cached(Primitive<cells>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "CELLS");
+    s.tos *= CellSize;
+}
+
+// Define a binary operation on the second item x1 and the top item x2.
+#define CACHED_BINARY(fn, name, result) \
+    template<bool Checked> void cached(Primitive<fn>, CachedStack<Checked>& s) { \
+        s.requireDepth(2, name); \
+        auto x1 = s[1]; auto x2 = s.tos; \
+        s.tos = static_cast<Cell>(result); --s.sp; \
+    }
+
+CACHED_BINARY(plus,       "+",      x1 + x2)
+CACHED_BINARY(minus,      "-",      x1 - x2)
+CACHED_BINARY(star,       "*",      static_cast<SCell>(x1) * static_cast<SCell>(x2))
+CACHED_BINARY(bitwiseAnd, "AND",    x1 & x2)
+CACHED_BINARY(bitwiseOr,  "OR",     x1 | x2)
+CACHED_BINARY(bitwiseXor, "XOR",    x1 ^ x2)
+CACHED_BINARY(lshift,     "LSHIFT", x1 << x2)
+CACHED_BINARY(rshift,     "RSHIFT", x1 >> x2)
+CACHED_BINARY(equals,     "=",      x1 == x2 ? True : False)
+CACHED_BINARY(lessThan,   "<",      static_cast<SCell>(x1) < static_cast<SCell>(x2) ? True : False)
+CACHED_BINARY(uLessThan,  "U<",     x1 < x2 ? True : False)
+CACHED_BINARY(greaterThan, ">",     static_cast<SCell>(x1) > static_cast<SCell>(x2) ? True : False)
+CACHED_BINARY(notEquals,  "<>",     x1 != x2 ? True : False)
+CACHED_BINARY(minimum,    "MIN",    std::min(static_cast<SCell>(x1), static_cast<SCell>(x2)))
+CACHED_BINARY(maximum,    "MAX",    std::max(static_cast<SCell>(x1), static_cast<SCell>(x2)))
+
+#undef CACHED_BINARY
+
+// Define a unary operation on the top item x.
+#define CACHED_UNARY(fn, name, result) \
+    template<bool Checked> void cached(Primitive<fn>, CachedStack<Checked>& s) { \
+        s.requireDepth(1, name); \
+        auto x = s.tos; \
+        s.tos = static_cast<Cell>(result); \
+    }
+
+CACHED_UNARY(onePlus,     "1+",     x + 1)
+CACHED_UNARY(oneMinus,    "1-",     x - 1)
+CACHED_UNARY(twoStar,     "2*",     x << 1)
+CACHED_UNARY(twoSlash,    "2/",     x >> 1)
+CACHED_UNARY(negate,      "NEGATE", 0 - x)
+CACHED_UNARY(invert,      "INVERT", ~x)
+CACHED_UNARY(absValue,    "ABS",    static_cast<SCell>(x) < 0 ? 0 - x : x)
+CACHED_UNARY(zeroLess,    "0<",     static_cast<SCell>(x) < 0 ? True : False)
+CACHED_UNARY(zeroEquals,  "0=",     x == 0 ? True : False)
+
+#undef CACHED_UNARY
+
+template<bool Checked> void cached(Primitive<over>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "OVER");
+    s.requireAvailable(1, "OVER");
+    s.push(s[1]);
+}
+
+template<bool Checked> void cached(Primitive<rot>, CachedStack<Checked>& s) {
+    s.requireDepth(3, "ROT");
+    auto x1 = s[2];
+    s[2] = s[1]; s[1] = s.tos; s.tos = x1;
+}
+
+template<bool Checked> void cached(Primitive<nip>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "NIP");
+    --s.sp;
+}
+
+template<bool Checked> void cached(Primitive<tuck>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "TUCK");
+    s.requireAvailable(1, "TUCK");
+    auto x1 = s[1];
+    s[1] = s.tos; *s.sp++ = x1;
+}
+
+template<bool Checked> void cached(Primitive<twoDrop>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "2DROP");
+    s.sp -= 2; s.tos = *s.sp;
+}
+
+template<bool Checked> void cached(Primitive<twoDup>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "2DUP");
+    s.requireAvailable(2, "2DUP");
+    auto x1 = s[1];
+    s.push(x1); s.push(s[1]);
+}
+
+template<bool Checked> void cached(Primitive<twoOver>, CachedStack<Checked>& s) {
+    s.requireDepth(4, "2OVER");
+    s.requireAvailable(2, "2OVER");
+    auto x1 = s[3];
+    s.push(x1); s.push(s[3]);
+}
+
+template<bool Checked> void cached(Primitive<twoSwap>, CachedStack<Checked>& s) {
+    s.requireDepth(4, "2SWAP");
+    std::swap(s.tos, s[2]);
+    std::swap(s[1], s[3]);
+}
+
+template<bool Checked> void cached(Primitive<questionDup>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "?DUP");
+    if (s.tos != 0) {
+        s.requireAvailable(1, "?DUP");
+        s.push(s.tos);
+    }
+}
+
+template<bool Checked> void cached(Primitive<doDo>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "DO");
+    REQUIRE_RSTACK_AVAILABLE(2, "DO");
+    rpush(s[1]); rpush(s.tos);
+    s.sp -= 2; s.tos = *s.sp;
+}
+
+template<bool Checked> void cached(Primitive<loopIndex>, CachedStack<Checked>& s) {
+    REQUIRE_RSTACK_DEPTH(2, "I");
+    s.requireAvailable(1, "I");
+    s.push(*rTop);
+}
+
+template<bool Checked> void cached(Primitive<outerLoopIndex>, CachedStack<Checked>& s) {
+    REQUIRE_RSTACK_DEPTH(4, "J");
+    s.requireAvailable(1, "J");
+    s.push(*(rTop - 2));
+}
+
+template<bool Checked> void cached(Primitive<plusStore>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "+!");
+    auto aaddr = AADDR(s.tos);
+    REQUIRE_ALIGNED(aaddr, "+!");
+    *aaddr += s[1];
+    s.sp -= 2; s.tos = *s.sp;
+}
+
+template<bool Checked> void cached(Primitive<overOver>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "OVER");
+    s.requireAvailable(2, "OVER");
+    auto x1 = s[1];
+    s.push(x1); s.push(s[1]);
+}
+
+template<bool Checked> void cached(Primitive<swapDrop>, CachedStack<Checked>& s) {
+    s.requireDepth(2, "SWAP");
+    --s.sp;
+}
+
+template<bool Checked> void cached(Primitive<fetchPlus>, CachedStack<Checked>& s) {
+    s.requireDepth(1, "@");
+    auto aaddr = AADDR(s.tos);
+    REQUIRE_ALIGNED(aaddr, "@");
+    s.requireDepth(2, "+");
+    s.tos = s[1] + *aaddr; --s.sp;
+}
+
+#endif
+
+/****
+
+Direct-Threaded Code
+--------------------
+
+In the introduction, I said I wasn't going to talk about the trade-offs
+between different threading techniques.  I lied.
+
+The `doColon()` loop above is easy to understand, but it does a lot of work for
+every instruction: it calls `Definition::execute()`, which saves and restores
+`executingWord` and then makes an indirect call through the `code` field, and
+the primitive then returns back to the loop.  For a colon definition that
+consists mostly of simple primitives like `DUP` and `+`, this overhead costs
+more than the primitives themselves.
+
+GCC and Clang provide an extension called [labels as values][labelsAsValues],
+which lets C++ code take the address of a label with `&&label` and jump to it
+with `goto *address`.  That's what we need to build a traditional
+_direct-threaded_ inner interpreter, in which each compiled instruction is the
+address of the machine code that implements it, and each primitive ends with
+its own copy of the jump to the next instruction.  Replicating that dispatch
+lets the CPU's branch predictor learn the common successor of each primitive,
+rather than trying to predict one shared indirect call in `doColon()`.
+
+If the macro `CXXFORTH_DIRECT_THREADED` is defined (pass
+`-DCXXFORTH_DIRECT_THREADED=ON` to `cmake`, or use `make threaded`), `doColon()`
+is implemented this way.  Colon definitions are still compiled into data space
+as a sequence of XTs, so nothing else in the system has to know about it.  When
+a definition becomes hot, `translateBody()` decodes those XTs and a parallel array of cells in which each instruction has been replaced by a
+label address within `runThreaded()`:
+
+- The special words `(lit)`, `(does)`, `EXIT`, and the branches, including
+  those of counted loops, the superinstructions that have operands, and the
+  words that create and use locals, get their own labels, and
+  branch offsets are converted into absolute addresses within the translated
+  code.
+- The primitives listed in `THREADED_PRIMITIVES` each get their own label,
+  which calls the primitive's C++ function directly.  The compiler can expand
+  these calls inline, so there is no call/return at all.
+- A call to another colon definition is translated into a `colon` label
+  followed by the word's XT.  Rather than going through
+  `Definition::execute()` and `doColon()`, this pushes the instruction pointer
+  onto the call stack and jumps into the callee's translated code, and the
+  callee's `EXIT` jumps back, so `runThreaded()` never calls itself.  A
+  `(tail)` jumps into the callee's translated code without saving anything.
+- A call to a `DEFER`red word is translated into a `deferred` label followed
+  by the word's XT.  It fetches the word's current action, and if that is a
+  colon definition, calls it the same way as `colon` does.
+- Any other word is translated into a `call` label followed by the word's XT,
+  which is executed the usual way.
+
+The translations are kept in `threadedBodies`, keyed by the entry address, so
+all the words created by a `DOES>` defining word share a single translation.
+A definition whose stack effect is known also gets a second translation,
+kept in `uncheckedThreadedBodies`, which uses the labels of
+`runThreaded<false>()` and so doesn't check the data stack.
+
+The `tests/bench.fs` script contains a few small benchmarks.  `make bench`
+builds both the standard and the direct-threaded interpreters and times them.
+
+[labelsAsValues]: https://gcc.gnu.org/onlinedocs/gcc/Labels-as-Values.html "Labels as Values"
+
+****/
+
+#ifdef CXXFORTH_DIRECT_THREADED
+
+// Label addresses within runThreaded(), for use by translateBody().
+struct ThreadedLabels {
+    Cell exit            = 0;
+    Cell literal         = 0;
+    Cell branch          = 0;
+    Cell zbranch         = 0;
+    Cell litPlus         = 0;
+    Cell litEquals       = 0;
+    Cell dupZbranch      = 0;
+    Cell nzbranch        = 0;
+    Cell equalsBranch    = 0;
+    Cell notEqualsBranch = 0;
+    Cell lessBranch      = 0;
+    Cell greaterBranch   = 0;
+    Cell qdo             = 0;
+    Cell loop            = 0;
+    Cell plusLoop        = 0;
+    Cell setDoes         = 0;
+    Cell localFetch      = 0;
+    Cell localStore      = 0;
+    Cell locals          = 0;
+    Cell colon           = 0;
+    Cell deferred        = 0;
+    Cell tailCall        = 0;
+    Cell call            = 0;
+    std::unordered_map<Code, Cell> primitives;
+};
+
+// The labels within runThreaded<true>() and runThreaded<false>().
+template<bool Checked>
+ThreadedLabels threadedLabels;
+
+// Translated code, and the position of each data-space instruction within it.
+struct ThreadedBody {
+    std::vector<Cell> code;
+    std::unordered_map<AAddr, size_t> positions;
+};
+
+std::unordered_map<AAddr, ThreadedBody> threadedBodies;
+std::unordered_map<AAddr, ThreadedBody> uncheckedThreadedBodies;
+
+const Cell* translateBody(AAddr entry, bool checked, bool covered);
+
+// Return the checked or unchecked translation of a colon definition,
+// translating it if necessary.
+template<bool Checked>
+const Cell* threadedCode(const Definition* defn) {
+    auto& code = Checked ? defn->threaded : defn->uncheckedThreaded;
+    if (code == nullptr)
+        code = translateBody(defn->does, Checked, coversCallees(defn));
+    return code;
+}
+
+// Execute translated instructions until EXIT, with or without data stack
+// checks.
+//
+// If ip is nullptr, then just fill in threadedLabels<Checked>.
+template<bool Checked>
+void runThreaded(const Cell* ip) {
+    if (ip == nullptr) {
+        auto& labels = threadedLabels<Checked>;
+        labels.exit            = CELL(&&op_exit);
+        labels.literal         = CELL(&&op_literal);
+        labels.branch          = CELL(&&op_branch);
+        labels.zbranch         = CELL(&&op_zbranch);
+        labels.litPlus         = CELL(&&op_litPlus);
+        labels.litEquals       = CELL(&&op_litEquals);
+        labels.dupZbranch      = CELL(&&op_dupZbranch);
+        labels.nzbranch        = CELL(&&op_nzbranch);
+        labels.equalsBranch    = CELL(&&op_equalsBranch);
+        labels.notEqualsBranch = CELL(&&op_notEqualsBranch);
+        labels.lessBranch      = CELL(&&op_lessBranch);
+        labels.greaterBranch   = CELL(&&op_greaterBranch);
+        labels.qdo             = CELL(&&op_qdo);
+        labels.loop            = CELL(&&op_loop);
+        labels.plusLoop        = CELL(&&op_plusLoop);
+        labels.setDoes         = CELL(&&op_setDoes);
+        labels.localFetch      = CELL(&&op_localFetch);
+        labels.localStore      = CELL(&&op_localStore);
+        labels.locals          = CELL(&&op_locals);
+        labels.colon           = CELL(&&op_colon);
+        labels.deferred        = CELL(&&op_deferred);
+        labels.tailCall        = CELL(&&op_tailCall);
+        labels.call            = CELL(&&op_call);
+#define X(fn) labels.primitives[fn] = CELL(&&op_##fn);
+        THREADED_PRIMITIVES(X)
+#undef X
+        return;
+    }
+
+    auto base = callTop;
+
+    CachedStack<Checked> s;
+    s.fill();
+
+#define NEXT() goto *reinterpret_cast<void*>(*ip++)
+
+    NEXT();
+
+op_exit:
+    if (callTop == base) {
+        s.spill();
+        return;
+    }
+    ip = popReturn<const Cell*>();
+    NEXT();
+
+op_literal:
+    s.requireAvailable(1, "(lit)");
+    s.push(*ip++);
+    NEXT();
+
+op_branch:
+    ip = reinterpret_cast<const Cell*>(*ip);
+    NEXT();
+
+op_zbranch:
+    s.requireDepth(1, "(zbranch)");
+    if (s.tos == False)
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    s.pop();
+    NEXT();
+
+op_litPlus:
+    s.requireDepth(1, "+");
+    s.tos += *ip++;
+    NEXT();
+
+op_litEquals:
+    s.requireDepth(1, "=");
+    s.tos = s.tos == *ip++ ? True : False;
+    NEXT();
+
+op_dupZbranch:
+    s.requireDepth(1, "DUP");
+    if (s.tos == False)
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    NEXT();
+
+op_nzbranch:
+    s.requireDepth(1, "0=");
+    if (s.tos != 0)
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    s.pop();
+    NEXT();
+
+op_equalsBranch:
+    s.requireDepth(2, "=");
+    if (s[1] != s.tos)
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    s.sp -= 2; s.tos = *s.sp;
+    NEXT();
+
+op_notEqualsBranch:
+    s.requireDepth(2, "<>");
+    if (s[1] == s.tos)
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    s.sp -= 2; s.tos = *s.sp;
+    NEXT();
+
+op_lessBranch:
+    s.requireDepth(2, "<");
+    if (!(static_cast<SCell>(s[1]) < static_cast<SCell>(s.tos)))
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    s.sp -= 2; s.tos = *s.sp;
+    NEXT();
+
+op_greaterBranch:
+    s.requireDepth(2, ">");
+    if (!(static_cast<SCell>(s[1]) > static_cast<SCell>(s.tos)))
+        ip = reinterpret_cast<const Cell*>(*ip);
+    else
+        ++ip;
+    s.sp -= 2; s.tos = *s.sp;
+    NEXT();
+
+op_qdo:
+    s.requireDepth(2, "?DO");
+    if (s.tos == s[1]) {
+        ip = reinterpret_cast<const Cell*>(*ip);
+        s.sp -= 2; s.tos = *s.sp;
+    }
+    else {
+        cached(Primitive<doDo>(), s);
+        ++ip;
+    }
+    NEXT();
+
+op_loop:
+    REQUIRE_RSTACK_DEPTH(2, "LOOP");
+    if (++*rTop == *(rTop - 1)) {
+        rTop -= 2;
+        ++ip;
+    }
+    else {
+        ip = reinterpret_cast<const Cell*>(*ip);
+    }
+    NEXT();
+
+op_plusLoop:
+    s.requireDepth(1, "+LOOP");
+    REQUIRE_RSTACK_DEPTH(2, "+LOOP");
+    if (loopCrossesLimit(*rTop, *(rTop - 1), s.tos)) {
+        rTop -= 2;
+        ++ip;
+    }
+    else {
+        *rTop += s.tos;
+        ip = reinterpret_cast<const Cell*>(*ip);
+    }
+    s.pop();
+    NEXT();
+
+op_setDoes:
+    setDoesBody(AADDR(*ip++));
+    NEXT();
+
+op_localFetch:
+    s.requireAvailable(1, "(local@)");
+    s.push(localFrame[*ip++]);
+    NEXT();
+
+op_localStore:
+    s.requireDepth(1, "(local!)");
+    localFrame[*ip++] = s.tos;
+    s.pop();
+    NEXT();
+
+op_locals:
+    s.spill();
+    enterLocals(*ip++);
+    s.fill();
+    NEXT();
+
+op_colon:
+    {
+        auto defn = XT(*ip++);
+        if (defn->code != doColon) {
+            s.spill();
+            defn->execute();
+            s.fill();
+        }
+        else {
+            pushReturn(ip, defn->name.c_str());
+            ip = threadedCode<Checked>(defn);
+        }
+    }
+    NEXT();
+
+op_deferred:
+    {
+        // Unchecked code that calls a deferred word belongs to an UNCHECKED
+        // word whose stack effect isn't known, and doesn't cover the action's.
+        auto action = XT(*XT(*ip++)->parameter);
+        if (action->code == doColon && canCallDirectly(action, Checked, false)) {
+            pushReturn(ip, action->name.c_str());
+            ip = threadedCode<Checked>(action);
+        }
+        else {
+            s.spill();
+            action->execute();
+            s.fill();
+        }
+    }
+    NEXT();
+
+op_tailCall:
+    ip = threadedCode<Checked>(XT(*ip));
+    NEXT();
+
+op_call:
+    s.spill();
+    XT(*ip++)->execute();
+    s.fill();
+    NEXT();
+
+#define X(fn) op_##fn: cached(Primitive<fn>(), s); NEXT();
+    THREADED_PRIMITIVES(X)
+#undef X
+
+#undef NEXT
+}
+
+// Translate the instructions starting at entry into direct-threaded code,
+// for runThreaded<checked>().  covered is coversCallees() of the definition.
+const Cell* translateBody(AAddr entry, bool checked, bool covered) {
+    auto& bodies = checked ? threadedBodies : uncheckedThreadedBodies;
+    auto found = bodies.find(entry);
+    if (found != bodies.end())
+        return found->second.code.data();
+
+    if (threadedLabels<true>.exit == 0) {
+        runThreaded<true>(nullptr);
+        runThreaded<false>(nullptr);
+    }
+    auto& labels = checked ? threadedLabels<true> : threadedLabels<false>;
+
+    auto instructions = decodeBody(entry);
+
+    auto& body = bodies[entry];
+    auto& code = body.code;
+    auto& positions = body.positions;
+    std::vector<std::pair<size_t, AAddr>> branchFixups;
+
+    auto appendWord = [&](Xt xt) {
+        auto primitive = labels.primitives.find(xt->code);
+        if (primitive != labels.primitives.end()) {
+            code.push_back(primitive->second);
+        }
+        else {
+            code.push_back(xt->code == doColon && canCallDirectly(xt, checked, covered) ? labels.colon
+                           : xt->code == doDefer ? labels.deferred
+                           : labels.call);
+            code.push_back(CELL(xt));
+        }
+    };
+
+    for (auto& instruction: instructions) {
+        positions[instruction.address] = code.size();
+
+        auto xt = instruction.xt;
+        if (xt == exitXt) {
+            code.push_back(labels.exit);
+        }
+        else if (xt == doLiteralXt) {
+            code.push_back(labels.literal);
+            code.push_back(instruction.operand);
+        }
+        else if (xt == litPlusXt || xt == litEqualsXt) {
+            code.push_back(xt == litPlusXt ? labels.litPlus : labels.litEquals);
+            code.push_back(instruction.operand);
+        }
+        else if (xt == localFetchXt || xt == localStoreXt || xt == localsXt) {
+            code.push_back(xt == localFetchXt ? labels.localFetch
+                           : xt == localStoreXt ? labels.localStore
+                           : labels.locals);
+            code.push_back(instruction.operand);
+        }
+        else if (instruction.isBranch()) {
+            if (xt == branchXt)
+                code.push_back(labels.branch);
+            else if (xt == zbranchXt)
+                code.push_back(labels.zbranch);
+            else if (xt == dupZbranchXt)
+                code.push_back(labels.dupZbranch);
+            else if (xt == nzbranchXt)
+                code.push_back(labels.nzbranch);
+            else if (xt == equalsBranchXt)
+                code.push_back(labels.equalsBranch);
+            else if (xt == notEqualsBranchXt)
+                code.push_back(labels.notEqualsBranch);
+            else if (xt == lessBranchXt)
+                code.push_back(labels.lessBranch);
+            else if (xt == greaterBranchXt)
+                code.push_back(labels.greaterBranch);
+            else if (xt == qdoXt)
+                code.push_back(labels.qdo);
+            else if (xt == loopXt)
+                code.push_back(labels.loop);
+            else
+                code.push_back(labels.plusLoop);
+            branchFixups.emplace_back(code.size(), instruction.target);
+            code.push_back(0);
+        }
+        else if (xt == setDoesXt) {
+            // The DOES> instructions start after the EXIT that follows (does).
+            code.push_back(labels.setDoes);
+            code.push_back(CELL(instruction.address + 2));
+        }
+        else if (xt == tailCallXt) {
+            if (canCallDirectly(XT(instruction.operand), checked, covered)) {
+                code.push_back(labels.tailCall);
+                code.push_back(instruction.operand);
+            }
+            else {
+                appendWord(XT(instruction.operand));
+                code.push_back(labels.exit);
+            }
+        }
+        else if (xt->code == doFused) {
+            for (auto word = xt->parameter; *word != 0; ++word)
+                appendWord(XT(*word));
+        }
+        else {
+            appendWord(xt);
+        }
+    }
+
+    // Now that the code won't be moved, convert branch targets to addresses.
+    for (auto& fixup: branchFixups)
+        code[fixup.first] = CELL(code.data() + positions[fixup.second]);
+
+    return code.data();
+}
+
+// Return the address of the translated code for the instruction at resume.
+template<bool Checked>
+const Cell* threadedCode(const Definition* defn, AAddr resume) {
+    auto code = threadedCode<Checked>(defn);
+    if (resume == defn->does)
+        return code;
+    auto& body = (Checked ? threadedBodies : uncheckedThreadedBodies)[defn->does];
+    return code + body.positions[resume];
+}
+
+bool hasTranslation(const Definition* defn) {
+    return defn->threaded != nullptr || defn->uncheckedThreaded != nullptr;
+}
+
+void runTranslation(const Definition* defn, AAddr resume) {
+    if (canRunUnchecked(defn, resume))
+        runThreaded<false>(threadedCode<false>(defn, resume));
+    else
+        runThreaded<true>(threadedCode<true>(defn, resume));
+}
+
+#endif // CXXFORTH_DIRECT_THREADED
+
+/****
+
+Token-Threaded Code
+-------------------
+
+A colon definition in data space uses a full cell for each instruction, and
+another full cell for each literal value and branch offset.  On a 64-bit
+platform, `: 1+ 1 + ;` occupies 40 bytes.  That's a lot of memory for the CPU's
+caches to hold, and a big Forth program can spend a lot of its time waiting
+for instructions to be loaded.
+
+If the macro `CXXFORTH_TOKEN_THREADED` is defined (pass
+`-DCXXFORTH_TOKEN_THREADED=ON` to `cmake`), `doColon()` instead executes a
+compact _token-threaded_ bytecode translation of each definition, using these
+encodings:
+
+- `EXIT` and the primitives listed in `THREADED_PRIMITIVES` are one-byte
+  opcodes.
+- A literal is an opcode followed by its value as a signed [LEB128][leb128]
+  number, so values from -64 to 63 take one byte.  So are `(lit+)` and
+  `(lit=)`, and the indexes of `(local@)` and `(local!)` and the size of a
+  `(locals)` frame.
+- A branch is an opcode followed by a signed LEB128 offset relative to the end
+  of the branch instruction.  Short branches take two bytes in total.
+- A call to any other word is an opcode followed by a 16-bit index into the
+  `tokenDefinitions` table, or a 32-bit index if there are more than 65536
+  such words.  So is `(tail)`.  There are separate opcodes for calls to colon
+  definitions, which run in the same loop, and to `DEFER`red words, which
+  fetch the current action and run it in the same loop if it is a colon
+  definition.
+- `(does)` is an opcode followed by the address of the `DOES>` instructions.
+
+So `: 1+ 1 + ;` becomes the four bytes `OpLiteral 1 Op_plus OpExit`.
+
+As with direct-threaded code, the bytecode is generated from the data-space
+body when a definition becomes hot, so the compiler and everything
+else in the system continue to deal only with XTs.  The bytecode is stored in
+a separate code space, whose size is set by `CXXFORTH_CODESPACE_SIZE`.
+
+This makes the code that the inner interpreter runs smaller, but it doesn't
+make data space go any further.  The data-space body is still compiled first,
+and kept, because `SEE`, `DOES>`, inline strings, and the optimizer all read
+it, and the code space is extra memory on top of data space.  A program that
+runs out of data space needs a bigger `CXXFORTH_DATASPACE_SIZE` in this build,
+just as in any other.
+
+With GCC or Clang, the interpreter dispatches each opcode by jumping through a
+table of label addresses, with a copy of that jump at the end of each
+opcode's implementation.  With other compilers, it falls back to an ordinary
+`switch` statement.
+
+The bytecode doesn't say whether the data stack is checked, so a definition
+whose stack effect is known has just one translation, which is run by either
+`runTokens<true>()` or `runTokens<false>()`.  An `UNCHECKED` word whose stack
+effect isn't known is only ever run by `runTokens<false>()`, so its bytecode
+calls the words it can't call directly through `doColon()`, as described in
+**Tiered Execution**.
+
+[leb128]: https://en.wikipedia.org/wiki/LEB128 "LEB128"
+
+****/
+
+#if defined(CXXFORTH_TOKEN_THREADED) || defined(CXXFORTH_JIT)
+
+CAddr codeSpace      = nullptr;
+CAddr codeSpaceLimit = nullptr;
+CAddr codePointer    = nullptr;
+
+// Allocate the code space if that hasn't been done yet, and make it empty.
+void resetCodeSpace() {
+    if (codeSpace == nullptr) {
+#ifdef CXXFORTH_JIT
+        auto space = mmap(nullptr, CXXFORTH_CODESPACE_SIZE,
+                          PROT_READ | PROT_WRITE | PROT_EXEC,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (space == MAP_FAILED)
+            throw runtime_error("unable to allocate code space");
+        codeSpace = CADDR(space);
+#else
+        static Char space[CXXFORTH_CODESPACE_SIZE];
+        codeSpace = space;
+#endif
+        codeSpaceLimit = codeSpace + CXXFORTH_CODESPACE_SIZE;
+    }
+    codePointer = codeSpace;
+}
+
+// Copy code into the code space, returning its address.
+CAddr storeCode(const std::vector<Char>& code) {
+    if (codePointer + code.size() > codeSpaceLimit)
+        throw AbortException("code space overflow", ThrowDictionaryOverflow);
+    auto address = codePointer;
+    std::memcpy(address, code.data(), code.size());
+    codePointer += code.size();
+    return address;
+}
+
+// UNUSED-CODE ( -- u )
+//
+// Not a standard word.
+//
+// Like UNUSED, but gives the number of bytes remaining in the code space.
+void unusedCode() {
+    REQUIRE_DSTACK_AVAILABLE(1, "UNUSED-CODE");
+    push(static_cast<Cell>(codeSpaceLimit - codePointer));
+}
+
+#endif
+
+#ifdef CXXFORTH_TOKEN_THREADED
+
+enum Opcode: Char {
+    OpExit,
+    OpLiteral,
+    OpBranch,
+    OpZBranch,
+    OpLitPlus,
+    OpLitEquals,
+    OpDupZBranch,
+    OpNZBranch,
+    OpEqualsBranch,
+    OpNotEqualsBranch,
+    OpLessBranch,
+    OpGreaterBranch,
+    OpQDo,
+    OpLoop,
+    OpPlusLoop,
+    OpSetDoes,
+    OpLocalFetch,
+    OpLocalStore,
+    OpLocals,
+    OpColon16,
+    OpColon32,
+    OpCall16,
+    OpCall32,
+    OpDeferred16,
+    OpDeferred32,
+    OpTail16,
+    OpTail32,
+#define X(fn) Op_##fn,
+    THREADED_PRIMITIVES(X)
+#undef X
+};
+
+std::vector<Xt> tokenDefinitions;
+std::unordered_map<Xt, Cell> tokenIndexes;
+// Bytecode, and the position of each data-space instruction within it.
+struct TokenBody {
+    const Char* tokens = nullptr;
+    std::unordered_map<AAddr, size_t> positions;
+};
+
+std::unordered_map<AAddr, TokenBody> tokenBodies;
+
+const Char* encodeBody(AAddr entry, bool covered);
+
+// Return the number of bytes needed to encode a value as signed LEB128.
+size_t signedWidth(SCell value) {
+    size_t width = 1;
+    while (value < -64 || 63 < value) {
+        value >>= 7;
+        ++width;
+    }
+    return width;
+}
+
+// Append a value as signed LEB128, padded to the specified number of bytes.
+void appendSigned(std::vector<Char>& code, SCell value, size_t width) {
+    auto bits = static_cast<Cell>(value);
+    for (size_t i = 1; i < width; ++i) {
+        code.push_back(static_cast<Char>((bits & 0x7f) | 0x80));
+        bits = static_cast<Cell>(static_cast<SCell>(bits) >> 7);
+    }
+    code.push_back(static_cast<Char>(bits & 0x7f));
+}
+
+// Read a signed LEB128 value, and advance past it.
+SCell readSigned(const Char*& bp) {
+    Cell result = 0;
+    size_t shift = 0;
+    Char byte;
+    do {
+        byte = *bp++;
+        result |= static_cast<Cell>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    if (shift < CellSize * 8 && (byte & 0x40))
+        result |= ~Cell(0) << shift;
+    return static_cast<SCell>(result);
+}
+
+// Read a little-endian unsigned value of the specified number of bytes, and
+// advance past it.
+Cell readUnsigned(const Char*& bp, size_t width) {
+    Cell result = 0;
+    for (size_t i = 0; i < width; ++i)
+        result |= static_cast<Cell>(*bp++) << (8 * i);
+    return result;
+}
+
+// Execute bytecode until EXIT, with or without data stack checks.
+template<bool Checked>
+void runTokens(const Char* bp) {
+    auto base = callTop;
+
+    CachedStack<Checked> s;
+    s.fill();
+
+#ifdef __GNUC__
+    static void* const labels[] = {
+        &&case_OpExit, &&case_OpLiteral, &&case_OpBranch, &&case_OpZBranch,
+        &&case_OpLitPlus, &&case_OpLitEquals, &&case_OpDupZBranch,
+        &&case_OpNZBranch, &&case_OpEqualsBranch, &&case_OpNotEqualsBranch,
+        &&case_OpLessBranch, &&case_OpGreaterBranch, &&case_OpQDo, &&case_OpLoop, &&case_OpPlusLoop, &&case_OpSetDoes,
+        &&case_OpLocalFetch, &&case_OpLocalStore, &&case_OpLocals,
+        &&case_OpColon16, &&case_OpColon32, &&case_OpCall16, &&case_OpCall32,
+        &&case_OpDeferred16, &&case_OpDeferred32, &&case_OpTail16, &&case_OpTail32,
+#define X(fn) &&case_Op_##fn,
+        THREADED_PRIMITIVES(X)
+#undef X
+    };
+#define CASE(op) case_##op
+#define NEXT()   goto *labels[*bp++]
+    NEXT();
+    {
+#else
+#define CASE(op) case op
+#define NEXT()   continue
+    for (;;) {
+        switch (*bp++) {
+        default:
+            throw AbortException("invalid bytecode");
+#endif
+
+    CASE(OpExit):
+        if (callTop == base) {
+            s.spill();
+            return;
+        }
+        bp = popReturn<const Char*>();
+        NEXT();
+
+    CASE(OpLiteral):
+        s.requireAvailable(1, "(lit)");
+        s.push(static_cast<Cell>(readSigned(bp)));
+        NEXT();
+
+    CASE(OpBranch): {
+        auto offset = readSigned(bp);
+        bp += offset;
+        NEXT();
+    }
+
+    CASE(OpZBranch): {
+        s.requireDepth(1, "(zbranch)");
+        auto offset = readSigned(bp);
+        if (s.tos == False)
+            bp += offset;
+        s.pop();
+        NEXT();
+    }
+
+    CASE(OpLitPlus):
+        s.requireDepth(1, "+");
+        s.tos += static_cast<Cell>(readSigned(bp));
+        NEXT();
+
+    CASE(OpLitEquals):
+        s.requireDepth(1, "=");
+        s.tos = s.tos == static_cast<Cell>(readSigned(bp)) ? True : False;
+        NEXT();
+
+    CASE(OpDupZBranch): {
+        s.requireDepth(1, "DUP");
+        auto offset = readSigned(bp);
+        if (s.tos == False)
+            bp += offset;
+        NEXT();
+    }
+
+    CASE(OpNZBranch): {
+        s.requireDepth(1, "0=");
+        auto offset = readSigned(bp);
+        if (s.tos != 0)
+            bp += offset;
+        s.pop();
+        NEXT();
+    }
+
+    CASE(OpEqualsBranch): {
+        s.requireDepth(2, "=");
+        auto offset = readSigned(bp);
+        if (s[1] != s.tos)
+            bp += offset;
+        s.sp -= 2; s.tos = *s.sp;
+        NEXT();
+    }
+
+    CASE(OpNotEqualsBranch): {
+        s.requireDepth(2, "<>");
+        auto offset = readSigned(bp);
+        if (s[1] == s.tos)
+            bp += offset;
+        s.sp -= 2; s.tos = *s.sp;
+        NEXT();
+    }
+
+    CASE(OpLessBranch): {
+        s.requireDepth(2, "<");
+        auto offset = readSigned(bp);
+        if (!(static_cast<SCell>(s[1]) < static_cast<SCell>(s.tos)))
+            bp += offset;
+        s.sp -= 2; s.tos = *s.sp;
+        NEXT();
+    }
+
+    CASE(OpGreaterBranch): {
+        s.requireDepth(2, ">");
+        auto offset = readSigned(bp);
+        if (!(static_cast<SCell>(s[1]) > static_cast<SCell>(s.tos)))
+            bp += offset;
+        s.sp -= 2; s.tos = *s.sp;
+        NEXT();
+    }
+
+    CASE(OpQDo): {
+        s.requireDepth(2, "?DO");
+        auto offset = readSigned(bp);
+        if (s.tos == s[1]) {
+            bp += offset;
+            s.sp -= 2; s.tos = *s.sp;
+        }
+        else {
+            cached(Primitive<doDo>(), s);
+        }
+        NEXT();
+    }
+
+    CASE(OpLoop): {
+        REQUIRE_RSTACK_DEPTH(2, "LOOP");
+        auto offset = readSigned(bp);
+        if (++*rTop == *(rTop - 1))
+            rTop -= 2;
+        else
+            bp += offset;
+        NEXT();
+    }
+
+    CASE(OpPlusLoop): {
+        s.requireDepth(1, "+LOOP");
+        REQUIRE_RSTACK_DEPTH(2, "+LOOP");
+        auto offset = readSigned(bp);
+        if (loopCrossesLimit(*rTop, *(rTop - 1), s.tos)) {
+            rTop -= 2;
+        }
+        else {
+            *rTop += s.tos;
+            bp += offset;
+        }
+        s.pop();
+        NEXT();
+    }
+
+    CASE(OpSetDoes): {
+        Cell body;
+        std::memcpy(&body, bp, CellSize);
+        bp += CellSize;
+        setDoesBody(AADDR(body));
+        NEXT();
+    }
+
+    CASE(OpLocalFetch):
+        s.requireAvailable(1, "(local@)");
+        s.push(localFrame[readSigned(bp)]);
+        NEXT();
+
+    CASE(OpLocalStore):
+        s.requireDepth(1, "(local!)");
+        localFrame[readSigned(bp)] = s.tos;
+        s.pop();
+        NEXT();
+
+    CASE(OpLocals): {
+        auto n = static_cast<Cell>(readSigned(bp));
+        s.spill();
+        enterLocals(n);
+        s.fill();
+        NEXT();
+    }
+
+    CASE(OpColon16):
+    CASE(OpColon32): {
+        auto defn = tokenDefinitions[readUnsigned(bp, bp[-1] == OpColon16 ? 2 : 4)];
+        if (defn->code != doColon || !canCallDirectly(defn, Checked, true)) {
+            s.spill();
+            defn->execute();
+            s.fill();
+        }
+        else {
+            if (defn->tokens == nullptr)
+                defn->tokens = encodeBody(defn->does, coversCallees(defn));
+            pushReturn(bp, defn->name.c_str());
+            bp = defn->tokens;
+        }
+        NEXT();
+    }
+
+    CASE(OpCall16):
+        s.spill();
+        tokenDefinitions[readUnsigned(bp, 2)]->execute();
+        s.fill();
+        NEXT();
+
+    CASE(OpCall32):
+        s.spill();
+        tokenDefinitions[readUnsigned(bp, 4)]->execute();
+        s.fill();
+        NEXT();
+
+    CASE(OpDeferred16):
+    CASE(OpDeferred32): {
+        auto defer = tokenDefinitions[readUnsigned(bp, bp[-1] == OpDeferred16 ? 2 : 4)];
+        // See op_deferred in runThreaded().
+        auto action = XT(*defer->parameter);
+        if (action->code == doColon && canCallDirectly(action, Checked, false)) {
+            if (action->tokens == nullptr)
+                action->tokens = encodeBody(action->does, coversCallees(action));
+            pushReturn(bp, action->name.c_str());
+            bp = action->tokens;
+        }
+        else {
+            s.spill();
+            action->execute();
+            s.fill();
+        }
+        NEXT();
+    }
+
+    CASE(OpTail16):
+    CASE(OpTail32): {
+        auto defn = tokenDefinitions[readUnsigned(bp, bp[-1] == OpTail16 ? 2 : 4)];
+        if (!canCallDirectly(defn, Checked, true)) {
+            // Call it through doColon(), and then exit.
+            s.spill();
+            defn->execute();
+            s.fill();
+            if (callTop == base) {
+                s.spill();
+                return;
+            }
+            bp = popReturn<const Char*>();
+            NEXT();
+        }
+        if (defn->tokens == nullptr)
+            defn->tokens = encodeBody(defn->does, coversCallees(defn));
+        bp = defn->tokens;
+        NEXT();
+    }
+
+#define X(fn) CASE(Op_##fn): cached(Primitive<fn>(), s); NEXT();
+    THREADED_PRIMITIVES(X)
+#undef X
+
+#ifndef __GNUC__
+        }
+#endif
+    }
+
+#undef CASE
+#undef NEXT
+}
+
+// Return the index of a word in tokenDefinitions, adding it if necessary.
+Cell tokenIndex(Xt xt) {
+    auto found = tokenIndexes.find(xt);
+    if (found != tokenIndexes.end())
+        return found->second;
+    auto index = static_cast<Cell>(tokenDefinitions.size());
+    tokenDefinitions.push_back(xt);
+    tokenIndexes[xt] = index;
+    return index;
+}
+
+// Translate the instructions starting at entry into bytecode.  covered is
+// coversCallees() of the definition.
+const Char* encodeBody(AAddr entry, bool covered) {
+    auto found = tokenBodies.find(entry);
+    if (found != tokenBodies.end())
+        return found->second.tokens;
+
+    static std::unordered_map<Code, Opcode> primitiveOpcodes = {
+#define X(fn) {fn, Op_##fn},
+        THREADED_PRIMITIVES(X)
+#undef X
+    };
+
+    auto instructions = decodeBody(entry);
+
+    auto wordSize = [&](Xt xt) -> size_t {
+        if (xt == exitXt || primitiveOpcodes.count(xt->code) != 0)
+            return 1;
+        return tokenIndex(xt) > 0xffff ? 5 : 3;
+    };
+
+    // Bytecode that doesn't cover its callees' stack effects only runs
+    // without checks, and calls all but UNCHECKED words through doColon().
+    auto callsDirectly = [&](Xt xt) {
+        return covered || canCallDirectly(xt, false, false);
+    };
+
+    // Branch offsets depend upon the sizes of the instructions between the
+    // branch and its target, which in turn may depend upon other branch
+    // offsets.  So start by assuming every branch offset fits in one byte, and
+    // then keep widening the ones that don't fit until nothing changes.
+    std::vector<size_t> sizes;
+    for (auto& instruction: instructions) {
+        auto xt = instruction.xt;
+        if (xt == doLiteralXt || xt == litPlusXt || xt == litEqualsXt
+                || xt == localFetchXt || xt == localStoreXt || xt == localsXt)
+            sizes.push_back(1 + signedWidth(static_cast<SCell>(instruction.operand)));
+        else if (instruction.isBranch())
+            sizes.push_back(2);
+        else if (xt == setDoesXt)
+            sizes.push_back(1 + CellSize);
+        else if (xt == tailCallXt)
+            sizes.push_back(wordSize(XT(instruction.operand))
+                            + (callsDirectly(XT(instruction.operand)) ? 0 : 1));
+        else if (xt->code == doFused) {
+            size_t size = 0;
+            for (auto word = xt->parameter; *word != 0; ++word)
+                size += wordSize(XT(*word));
+            sizes.push_back(size);
+        }
+        else
+            sizes.push_back(wordSize(xt));
+    }
+
+    auto body = TokenBody();
+    auto& positions = body.positions;
+    auto branchOffset = [&](size_t i) {
+        auto& instruction = instructions[i];
+        auto end = positions[instruction.address] + sizes[i];
+        return static_cast<SCell>(positions[instruction.target]) - static_cast<SCell>(end);
+    };
+    for (auto changed = true; changed; ) {
+        size_t position = 0;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            positions[instructions[i].address] = position;
+            position += sizes[i];
+        }
+        changed = false;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            if (instructions[i].isBranch()) {
+                auto size = 1 + signedWidth(branchOffset(i));
+                if (size > sizes[i]) {
+                    sizes[i] = size;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    std::vector<Char> code;
+    auto appendIndex = [&](Xt xt, Opcode op16, Opcode op32) {
+        auto index = tokenIndex(xt);
+        auto width = index > 0xffff ? 4 : 2;
+        code.push_back(width == 2 ? op16 : op32);
+        for (auto byte = 0; byte < width; ++byte)
+            code.push_back(static_cast<Char>(index >> (8 * byte)));
+    };
+    auto appendWord = [&](Xt xt) {
+        if (primitiveOpcodes.count(xt->code) != 0)
+            code.push_back(primitiveOpcodes[xt->code]);
+        else if (xt->code == doColon && callsDirectly(xt))
+            appendIndex(xt, OpColon16, OpColon32);
+        else if (xt->code == doDefer)
+            appendIndex(xt, OpDeferred16, OpDeferred32);
+        else
+            appendIndex(xt, OpCall16, OpCall32);
+    };
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto& instruction = instructions[i];
+        auto xt = instruction.xt;
+        if (xt == exitXt) {
+            code.push_back(OpExit);
+        }
+        else if (xt == doLiteralXt || xt == litPlusXt || xt == litEqualsXt) {
+            if (xt == doLiteralXt)
+                code.push_back(OpLiteral);
+            else
+                code.push_back(xt == litPlusXt ? OpLitPlus : OpLitEquals);
+            appendSigned(code, static_cast<SCell>(instruction.operand), sizes[i] - 1);
+        }
+        else if (xt == localFetchXt || xt == localStoreXt || xt == localsXt) {
+            code.push_back(xt == localFetchXt ? OpLocalFetch : xt == localStoreXt ? OpLocalStore : OpLocals);
+            appendSigned(code, static_cast<SCell>(instruction.operand), sizes[i] - 1);
+        }
+        else if (instruction.isBranch()) {
+            if (xt == branchXt)
+                code.push_back(OpBranch);
+            else if (xt == zbranchXt)
+                code.push_back(OpZBranch);
+            else if (xt == dupZbranchXt)
+                code.push_back(OpDupZBranch);
+            else if (xt == nzbranchXt)
+                code.push_back(OpNZBranch);
+            else if (xt == equalsBranchXt)
+                code.push_back(OpEqualsBranch);
+            else if (xt == notEqualsBranchXt)
+                code.push_back(OpNotEqualsBranch);
+            else if (xt == lessBranchXt)
+                code.push_back(OpLessBranch);
+            else if (xt == greaterBranchXt)
+                code.push_back(OpGreaterBranch);
+            else if (xt == qdoXt)
+                code.push_back(OpQDo);
+            else
+                code.push_back(xt == loopXt ? OpLoop : OpPlusLoop);
+            appendSigned(code, branchOffset(i), sizes[i] - 1);
+        }
+        else if (xt == setDoesXt) {
+            // The DOES> instructions start after the EXIT that follows (does).
+            auto body = CELL(instruction.address + 2);
+            code.push_back(OpSetDoes);
+            code.insert(code.end(), CADDR(&body), CADDR(&body) + CellSize);
+        }
+        else if (xt == tailCallXt) {
+            if (callsDirectly(XT(instruction.operand))) {
+                appendIndex(XT(instruction.operand), OpTail16, OpTail32);
+            }
+            else {
+                appendIndex(XT(instruction.operand), OpCall16, OpCall32);
+                code.push_back(OpExit);
+            }
+        }
+        else if (xt->code == doFused) {
+            for (auto word = xt->parameter; *word != 0; ++word)
+                appendWord(XT(*word));
+        }
+        else {
+            appendWord(xt);
+        }
+    }
+
+    body.tokens = storeCode(code);
+    return (tokenBodies[entry] = std::move(body)).tokens;
+}
+
+bool hasTranslation(const Definition* defn) {
+    return defn->tokens != nullptr;
+}
+
+void runTranslation(const Definition* defn, AAddr resume) {
+    if (defn->tokens == nullptr)
+        defn->tokens = encodeBody(defn->does, coversCallees(defn));
+    auto bp = defn->tokens;
+    if (resume != defn->does)
+        bp += tokenBodies[defn->does].positions[resume];
+    if (canRunUnchecked(defn, resume))
+        runTokens<false>(bp);
+    else
+        runTokens<true>(bp);
+}
+
+#endif // CXXFORTH_TOKEN_THREADED
+
+/****
+
+Native Code
+-----------
+
+Any threaded interpreter, no matter how clever, still dispatches through an
+indirect jump for every instruction, and keeps the data stack in memory.  To
+get close to the speed of C for numeric loops, the instructions have to be
+translated into machine code.
+
+If the macro `CXXFORTH_JIT` is defined (pass `-DCXXFORTH_JIT=ON` to `cmake`, or
+use `make jit`), each colon definition that becomes hot is translated into
+x86-64 machine code in a code space allocated with `mmap()`.  As with the
+threaded interpreters, the definition is still compiled into data space as a
+sequence of XTs, so `SEE`, `EXECUTE`, `DEFER`, and the outer interpreter keep
+working unchanged.
+
+The machine code for a definition works like this:
+
+- The `rbx` register holds the data stack pointer, rather than the global
+  `dTop`, and other callee-saved registers hold the addresses of `dTop` and
+  `rTop` and the bounds of the data stack.
+- `(lit)`, `(branch)`, `(zbranch)`, `EXIT`, the superinstructions, the
+  counted-loop words, `(local@)` and `(local!)`, and simple primitives such
+  as `DUP`, `SWAP`, `+`, `@`, `!`, and `>R` are expanded inline.  Unless runtime
+  checks are disabled, the inline code checks the stack bounds and alignment
+  just as the C++ primitives do.  If a check fails, it calls the C++ primitive,
+  which reports the error.
+- A call to another colon definition, or a recursive call, is a direct `call`
+  instruction.  The called definitions are translated first, so this is
+  possible unless definitions call each other recursively.  Unless runtime
+  checks are disabled, the call also moves `callTop` up and back down, so
+  the depth of native calls is limited by the call stack just as the inner
+  interpreter's is.  A `(tail)` is a
+  `jmp` instead, after releasing this definition's stack frame.
+- A call to a `DEFER`red word goes through a _monomorphic inline cache_.  The
+  compiler records the word's action at the time, and the machine code
+  compares the word's data field with it.  If they're the same, it calls the
+  action directly, as a native `call` if it is a colon definition.  If not,
+  because `IS` has changed the action since, it executes the deferred word the
+  usual way.  Comparing the action on every call means that `IS` and `DEFER!`
+  never have to find and invalidate the caches.
+- Any other word is executed by calling `executeForNative()`, after storing
+  `rbx` into `dTop`.
+
+One complication is that a C++ exception can't be thrown through the machine
+code, because the C++ runtime doesn't know how to unwind its stack frames.  So
+`executeForNative()` catches any exception, saves it in `nativeException`, and
+returns `true`.  The machine code then returns a non-zero status to its caller,
+all the way back to `doColon()`, which rethrows the exception.  So a
+definition's `code` field still points to `doColon()`, which enters the machine
+code through `nativeEntry`, a small routine that loads the registers and then
+jumps to any instruction of the definition.  (Usually that's the first
+instruction, but it may be in the middle of a loop; see **Tiered Execution**.)
+Translated definitions call one another through their _inner_ entry points,
+which expect the registers to be loaded already.
+
+A definition whose stack effect is known is also compiled without any data
+stack checks.  A checked translation that calls it checks for `effect.in`
+cells and room for `effect.peak` more just once, at the call, and then calls
+the unchecked translation.  Unchecked translations also keep the stack items
+in registers where they can, as described in **Register Allocation** below.
+
+There is no floating-point or 32-bit support, and nothing is ever freed from the
+code space until the system is reset.
+
+****/
+
+#ifdef CXXFORTH_JIT
+
+// A translated definition.  inner is the entry point for calls from other
+// native code, body is the code for the first instruction, and instructions
+// maps each data-space instruction to its code.
+struct NativeWord {
+    CAddr inner = nullptr;
+    CAddr body  = nullptr;
+    std::unordered_map<AAddr, CAddr> instructions;
+};
+
+std::unordered_map<AAddr, NativeWord> nativeWords;
+std::unordered_map<AAddr, NativeWord> uncheckedNativeWords;
+
+// Enter native code at the specified address.  Returns non-zero if an
+// exception is pending.
+using NativeEntry = int(*)(CAddr);
+
+NativeEntry nativeEntry = nullptr;
+
+std::exception_ptr nativeException;
+
+// Execute a word on behalf of native code.  If it throws an exception, save the
+// exception and return true.
+bool executeForNative(Xt xt) {
+    try {
+        xt->execute();
+        return false;
+    }
+    catch (...) {
+        nativeException = std::current_exception();
+        return true;
+    }
+}
+
+// Create a frame of n locals on behalf of native code.  Returns true if an
+// exception was thrown.
+bool localsForNative(Cell n) {
+    try {
+        enterLocals(n);
+        return false;
+    }
+    catch (...) {
+        nativeException = std::current_exception();
+        return true;
+    }
+}
+
+// A failed runtime check, as reported by native code.
+struct NativeFailure {
+    const char* message;
+    SCell code;
+};
+
+// Report a failed runtime check on behalf of native code.  Always returns true.
+bool failForNative(const NativeFailure* failure) {
+    nativeException = std::make_exception_ptr(AbortException(failure->message, failure->code));
+    return true;
+}
+
+// Machine code for one definition.  Instructions are appended by the emit
+// functions, with the x86-64 assembly language shown in comments.
+struct NativeCompiler {
+    CAddr base;                // address the code will be stored at
+    bool checked;              // whether to check the data stack bounds
+    std::vector<Char> code;
+
+    // A call made only if an inline check fails, and the position to resume at.
+    struct SlowPath {
+        std::vector<size_t> jumps;
+        Cell function;
+        Cell argument;
+        size_t resume;
+    };
+    std::vector<SlowPath> slowPaths;
+    std::vector<size_t> openSlowPaths;   // indexes of the unfinished ones
+
+    std::vector<size_t> unwindJumps;
+
+    explicit NativeCompiler(CAddr b, bool c = true): base(b), checked(c) {}
+
+    void emit(std::initializer_list<Char> bytes) {
+        code.insert(code.end(), bytes);
+    }
+
+    void emit32(uint32_t value) {
+        for (size_t i = 0; i < 4; ++i)
+            code.push_back(static_cast<Char>(value >> (8 * i)));
+    }
+
+    void emit64(Cell value) {
+        for (size_t i = 0; i < 8; ++i)
+            code.push_back(static_cast<Char>(value >> (8 * i)));
+    }
+
+    // Emit a placeholder for a 32-bit relative address, returning its position.
+    size_t emitRel32() {
+        auto position = code.size();
+        emit32(0);
+        return position;
+    }
+
+    // Make the rel32 at position refer to the target position, which may be
+    // before the start of this code.
+    void patchRel32(size_t position, size_t target) {
+        auto rel = static_cast<SCell>(target - (position + 4));
+        for (size_t i = 0; i < 4; ++i)
+            code[position + i] = static_cast<Char>(static_cast<Cell>(rel) >> (8 * i));
+    }
+
+    // Emit a call to function(argument), which returns true if the word being
+    // executed has thrown an exception.
+    void emitHelperCall(Cell function, Cell argument) {
+        emit({0x49, 0x89, 0x1c, 0x24});              // mov [r12], rbx
+        emit({0x48, 0xbf}); emit64(argument);         // mov rdi, argument
+        emit({0x48, 0xb8}); emit64(function);         // mov rax, function
+        emit({0xff, 0xd0});                           // call rax
+        emit({0x49, 0x8b, 0x1c, 0x24});              // mov rbx, [r12]
+        emit({0x84, 0xc0});                           // test al, al
+        emit({0x0f, 0x85});                           // jnz unwind
+        unwindJumps.push_back(emitRel32());
+    }
+
+    void emitExecute(Xt xt) {
+        emitHelperCall(CELL(executeForNative), CELL(xt));
+    }
+
+    // Emit a call to an inner entry point of xt.  Like interpretBody(), the
+    // call counts against the call stack, and if that is full, xt is executed
+    // the usual way, which reports the overflow.
+    //
+    // If target is nullptr, xt's checked translation is still being compiled,
+    // so the call loads its entry point from xt->native, and executes xt the
+    // usual way if there still isn't one.
+    void emitNativeCall(Xt xt, CAddr target) {
+        beginInline(xt);
+        if (target == nullptr) {
+            emit({0x48, 0xb8}); emit64(CELL(&xt->native)); // mov rax, &xt->native
+            emit({0x48, 0x83, 0x38, 0x00});           // cmp qword [rax], 0
+            emitCheck(0x84);                          // je slow
+        }
+        pushCall();
+        if (target == nullptr) {
+            emit({0x48, 0xb8}); emit64(CELL(&xt->native)); // mov rax, &xt->native
+            emit({0x48, 0x8b, 0x00});                 // mov rax, [rax]
+            emit({0xff, 0x10});                       // call [rax] (inner)
+        }
+        else {
+            emit({0xe8});                             // call target
+            auto position = emitRel32();
+            patchRel32(position, SIZE_T(target - base));
+        }
+        popCall();
+        endInline();
+        emit({0x85, 0xc0});                           // test eax, eax
+        emit({0x0f, 0x85});                           // jnz unwind
+        unwindJumps.push_back(emitRel32());
+    }
+
+    // Emit a tail call of a native definition, which returns to this one's
+    // caller.
+    void emitNativeJump(CAddr target) {
+        emit({0x48, 0x83, 0xc4, 0x08});               // add rsp, 8
+        emit({0xe9});                                 // jmp target
+        auto position = emitRel32();
+        patchRel32(position, SIZE_T(target - base));
+    }
+
+    void emitExit() {
+        emit({0x48, 0x83, 0xc4, 0x08});               // add rsp, 8
+        emit({0x31, 0xc0});                           // xor eax, eax
+        emit({0xc3});                                 // ret
+    }
+
+    // Emit a call or tail call of the unchecked translation of xt.  Checked
+    // code first checks that the stack satisfies xt's stack effect, and if it
+    // doesn't, executes xt the usual way.
+    void emitUncheckedCall(Xt xt, bool tail) {
+        auto target = xt->uncheckedNative->inner;
+        beginInline(xt);
+        if (xt->effect.in > 0)
+            requireDepth(xt->effect.in);
+        if (xt->effect.peak > 0)
+            requireAvailable(xt->effect.peak);
+        if (tail)
+            emitNativeJump(target);
+        else
+            emitNativeCall(xt, target);
+        endInline();
+        if (tail && checked)
+            emitExit();
+    }
+
+    // Emit a call of a deferred word through a monomorphic inline cache.  If
+    // the word's action is still the one it had when this code was compiled,
+    // call that directly.  Otherwise, execute the deferred word the usual way.
+    // An action that is still being translated, as when a word calls itself
+    // through a deferred word, is called natively too, so the recursion doesn't
+    // nest C++ calls.
+    void emitDeferredCall(Xt xt) {
+        auto action = XT(*xt->parameter);
+        beginInline(xt);
+        emit({0x48, 0xb8}); emit64(CELL(xt->parameter)); // mov rax, a-addr
+        emit({0x48, 0xb9}); emit64(CELL(action));     // mov rcx, action
+        emit({0x48, 0x39, 0x08});                     // cmp [rax], rcx
+        emitCheck(0x85);                              // jne slow
+        if (action->code == doColon)
+            emitNativeCall(action, action->native != nullptr ? action->native->inner : nullptr);
+        else
+            emitExecute(action);
+        endInline();
+    }
+
+    // Start inline code that executes xt if a check fails.
+    void beginInline(Xt xt) {
+        beginInline(CELL(executeForNative), CELL(xt));
+    }
+
+    void beginInline(Cell function, Cell argument) {
+        openSlowPaths.push_back(slowPaths.size());
+        slowPaths.push_back(SlowPath{{}, function, argument, 0});
+    }
+
+    // Start inline code that reports a failure with message and throw code if
+    // a check fails.
+    void beginFailure(const char* message, SCell code) {
+        static std::map<const char*, NativeFailure> failures;
+        auto& failure = failures[message];
+        failure = NativeFailure{message, code};
+        beginInline(CELL(failForNative), CELL(&failure));
+    }
+
+    // Finish the innermost unfinished inline code.  Inline code may be
+    // nested, as a call of an unchecked translation contains a native call.
+    void endInline() {
+        auto index = openSlowPaths.back();
+        openSlowPaths.pop_back();
+        if (slowPaths[index].jumps.empty() && index + 1 == slowPaths.size())
+            slowPaths.pop_back();
+        else
+            slowPaths[index].resume = code.size();
+    }
+
+    // Emit a conditional jump (0x0f, opcode) to the current slow path.
+    void emitCheck(Char opcode) {
+        emit({0x0f, opcode});
+        slowPaths[openSlowPaths.back()].jumps.push_back(emitRel32());
+    }
+
+#ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
+
+    void requireDepth(size_t)      {}
+    void requireAvailable(size_t)  {}
+    void requireAligned()          {}
+    void requireRDepth(size_t)     {}
+    void requireRAvailable()       {}
+    void pushCall()                {}
+    void popCall()                 {}
+
+#else
+
+    // Emit lea rax, [reg + n*8], where modrm selects reg with an 8-bit
+    // displacement.
+    void emitLeaCells(Char rex, Char modrm, size_t n) {
+        if (n * CellSize < 0x80) {
+            emit({rex, 0x8d, modrm, static_cast<Char>(n * CellSize)});
+        }
+        else {
+            emit({rex, 0x8d, static_cast<Char>(modrm + 0x40)});
+            emit32(static_cast<uint32_t>(n * CellSize));
+        }
+    }
+
+    // Check that the data stack holds at least n cells.
+    void requireDepth(size_t n) {
+        if (!checked) return;
+        emitLeaCells(0x49, 0x45, n);                  // lea rax, [r13 + n*8]
+        emit({0x48, 0x39, 0xc3});                     // cmp rbx, rax
+        emitCheck(0x82);                              // jb slow
+    }
+
+    // Check that n more cells can be pushed onto the data stack.
+    void requireAvailable(size_t n) {
+        if (!checked || !needsAvailableCheck(n)) return;
+        emitLeaCells(0x48, 0x43, n);                  // lea rax, [rbx + n*8]
+        emit({0x4c, 0x39, 0xf0});                     // cmp rax, r14
+        emitCheck(0x83);                              // jae slow
+    }
+
+    // Check that the address in rax is cell-aligned.
+    void requireAligned() {
+        emit({0xa8, CellSize - 1});                   // test al, 7
+        emitCheck(0x85);                              // jnz slow
+    }
+
+    // Check that the return stack holds at least n cells, given rTop in rax.
+    void requireRDepth(size_t n) {
+        emit({0x48, 0xba}); emit64(CELL(rStack + n - 1)); // mov rdx, rStack + n - 1
+        emit({0x48, 0x39, 0xd0});                     // cmp rax, rdx
+        emitCheck(0x82);                              // jb slow
+    }
+
+    // Check that the return stack has room for a cell, given rTop + 1 in rax.
+    void requireRAvailable() {
+        if (!needsAvailableCheck(1)) return;
+        emit({0x48, 0xba}); emit64(CELL(rStackLimit)); // mov rdx, rStackLimit
+        emit({0x48, 0x39, 0xd0});                     // cmp rax, rdx
+        emitCheck(0x83);                              // jae slow
+    }
+
+    // Push an entry onto the call stack for a native call, as pushCall() does,
+    // if there's room.
+    void pushCall() {
+        emit({0x48, 0xb8}); emit64(CELL(&callTop));  // mov rax, &callTop
+        emit({0x48, 0x8b, 0x08});                     // mov rcx, [rax]
+        emit({0x48, 0x83, 0xc1, 0x08});               // add rcx, 8
+        emit({0x48, 0xba}); emit64(CELL(callStackLimit)); // mov rdx, callStackLimit
+        emit({0x48, 0x39, 0xd1});                     // cmp rcx, rdx
+        emitCheck(0x83);                              // jae slow
+        emit({0x48, 0x89, 0x08});                     // mov [rax], rcx
+    }
+
+    // Pop the entry pushed by pushCall(), keeping the status in eax.
+    void popCall() {
+        emit({0x48, 0xb9}); emit64(CELL(&callTop));  // mov rcx, &callTop
+        emit({0x48, 0x83, 0x29, 0x08});               // sub qword [rcx], 8
+    }
+
+#endif // CXXFORTH_SKIP_RUNTIME_CHECKS
+
+    // Emit a binary operation (0x48, opcode) of [rbx - 8] and [rbx], leaving
+    // the result in [rbx - 8] and popping the top of stack.
+    void emitBinary(Xt xt, Char opcode) {
+        beginInline(xt);
+        requireDepth(2);
+        emit({0x48, 0x8b, 0x03});                     // mov rax, [rbx]
+        emit({0x48, 0x83, 0xeb, 0x08});               // sub rbx, 8
+        emit({0x48, opcode, 0x03});                   // op [rbx], rax
+        endInline();
+    }
+
+    // Emit an instruction that replaces the top of stack in place.
+    void emitUnary(Xt xt, std::initializer_list<Char> instruction) {
+        beginInline(xt);
+        requireDepth(1);
+        emit(instruction);
+        endInline();
+    }
+
+    // Emit a comparison, using the setcc opcode (0x0f, opcode).
+    void emitCompare(Xt xt, Char opcode) {
+        beginInline(xt);
+        requireDepth(2);
+        emit({0x48, 0x8b, 0x03});                     // mov rax, [rbx]
+        emit({0x48, 0x83, 0xeb, 0x08});               // sub rbx, 8
+        emit({0x31, 0xc9});                           // xor ecx, ecx
+        emit({0x48, 0x39, 0x03});                     // cmp [rbx], rax
+        emit({0x0f, opcode, 0xc1});                   // setcc cl
+        emit({0x48, 0xf7, 0xd9});                     // neg rcx
+        emit({0x48, 0x89, 0x0b});                     // mov [rbx], rcx
+        endInline();
+    }
+
+    // Emit a shift of [rbx - 8] by [rbx], using the ModR/M byte for shl or shr.
+    void emitShift(Xt xt, Char modrm) {
+        beginInline(xt);
+        requireDepth(2);
+        emit({0x48, 0x8b, 0x0b});                     // mov rcx, [rbx]
+        emit({0x48, 0x83, 0xeb, 0x08});               // sub rbx, 8
+        emit({0x48, 0xd3, modrm});                    // shl/shr qword [rbx], cl
+        endInline();
+    }
+
+    void emitLiteral(Cell value) {
+        beginFailure("(lit): stack overflow", ThrowStackOverflow);
+        requireAvailable(1);
+        emit({0x48, 0x83, 0xc3, 0x08});               // add rbx, 8
+        auto svalue = static_cast<SCell>(value);
+        if (INT32_MIN <= svalue && svalue <= INT32_MAX) {
+            emit({0x48, 0xc7, 0x03});                 // mov qword [rbx], value
+            emit32(static_cast<uint32_t>(value));
+        }
+        else {
+            emit({0x48, 0xb8}); emit64(value);        // mov rax, value
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+        }
+        endInline();
+    }
+
+    // Emit (local@) i.
+    void emitLocalFetch(Cell i) {
+        beginFailure("(local@): stack overflow", ThrowStackOverflow);
+        requireAvailable(1);
+        emit({0x48, 0xb8}); emit64(CELL(&localFrame)); // mov rax, &localFrame
+        emit({0x48, 0x8b, 0x00});                     // mov rax, [rax]
+        emit({0x48, 0x8b, 0x80});                     // mov rax, [rax + i*8]
+        emit32(static_cast<uint32_t>(i * CellSize));
+        emit({0x48, 0x83, 0xc3, 0x08});               // add rbx, 8
+        emit({0x48, 0x89, 0x03});                     // mov [rbx], rax
+        endInline();
+    }
+
+    // Emit (local!) i.
+    void emitLocalStore(Cell i) {
+        beginFailure("(local!): stack underflow", ThrowStackUnderflow);
+        requireDepth(1);
+        emit({0x48, 0xb8}); emit64(CELL(&localFrame)); // mov rax, &localFrame
+        emit({0x48, 0x8b, 0x00});                     // mov rax, [rax]
+        emit({0x48, 0x8b, 0x0b});                     // mov rcx, [rbx]
+        emit({0x48, 0x89, 0x88});                     // mov [rax + i*8], rcx
+        emit32(static_cast<uint32_t>(i * CellSize));
+        emit({0x48, 0x83, 0xeb, 0x08});               // sub rbx, 8
+        endInline();
+    }
+
+    // Emit (lit+) or (lit=).
+    void emitLiteralOperation(Xt xt, Cell value) {
+        auto isPlus = xt == litPlusXt;
+        beginFailure(isPlus ? "+: stack underflow" : "=: stack underflow", ThrowStackUnderflow);
+        requireDepth(1);
+        if (!isPlus)
+            emit({0x31, 0xc9});                       // xor ecx, ecx
+        auto svalue = static_cast<SCell>(value);
+        if (INT32_MIN <= svalue && svalue <= INT32_MAX) {
+            // add/cmp qword [rbx], value
+            emit({0x48, 0x81, static_cast<Char>(isPlus ? 0x03 : 0x3b)});
+            emit32(static_cast<uint32_t>(value));
+        }
+        else {
+            emit({0x48, 0xb8}); emit64(value);        // mov rax, value
+            emit({0x48, static_cast<Char>(isPlus ? 0x01 : 0x39), 0x03}); // add/cmp [rbx], rax
+        }
+        if (!isPlus) {
+            emit({0x0f, 0x94, 0xc1});                 // sete cl
+            emit({0x48, 0xf7, 0xd9});                 // neg rcx
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+        }
+        endInline();
+    }
+
+    // Emit (do), after its data stack has been checked.
+    void emitDo() {
+        emit({0x49, 0x8b, 0x07});                     // mov rax, [r15]
+        emit({0x48, 0x83, 0xc0, 0x10});               // add rax, 16
+        requireRAvailable();
+        emit({0x48, 0x8b, 0x4b, 0xf8});               // mov rcx, [rbx - 8]
+        emit({0x48, 0x89, 0x48, 0xf8});               // mov [rax - 8], rcx
+        emit({0x48, 0x8b, 0x0b});                     // mov rcx, [rbx]
+        emit({0x48, 0x89, 0x08});                     // mov [rax], rcx
+        emit({0x49, 0x89, 0x07});                     // mov [r15], rax
+        emit({0x48, 0x83, 0xeb, 0x10});               // sub rbx, 16
+    }
+
+    // Emit the code that removes the loop-control parameters, given rTop in
+    // rax.
+    void emitUnloop() {
+        emit({0x48, 0x83, 0xe8, 0x10});               // sub rax, 16
+        emit({0x49, 0x89, 0x07});                     // mov [r15], rax
+    }
+
+    // Emit inline code for a primitive, a value, or a field.  Returns false if
+    // there is no inline implementation.
+    bool emitPrimitive(Xt xt) {
+        auto code = xt->code;
+        if (code == doField) {
+            emitLiteralOperation(litPlusXt, *xt->parameter);
+        }
+        else if (code == doValue) {
+            beginInline(xt);
+            requireAvailable(1);
+            emit({0x48, 0xb8}); emit64(CELL(xt->parameter)); // mov rax, a-addr
+            emit({0x48, 0x8b, 0x00});                 // mov rax, [rax]
+            emit({0x48, 0x83, 0xc3, 0x08});           // add rbx, 8
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == drop) {
+            beginInline(xt);
+            requireDepth(1);
+            emit({0x48, 0x83, 0xeb, 0x08});           // sub rbx, 8
+            endInline();
+        }
+        else if (code == dup) {
+            beginInline(xt);
+            requireDepth(1);
+            requireAvailable(1);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x48, 0x83, 0xc3, 0x08});           // add rbx, 8
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == swap) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x48, 0x8b, 0x4b, 0xf8});           // mov rcx, [rbx - 8]
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+            emit({0x48, 0x89, 0x43, 0xf8});           // mov [rbx - 8], rax
+            endInline();
+        }
+        else if (code == toR) {
+            beginInline(xt);
+            requireDepth(1);
+            emit({0x49, 0x8b, 0x07});                 // mov rax, [r15]
+            emit({0x48, 0x83, 0xc0, 0x08});           // add rax, 8
+            requireRAvailable();
+            emit({0x48, 0x8b, 0x0b});                 // mov rcx, [rbx]
+            emit({0x48, 0x89, 0x08});                 // mov [rax], rcx
+            emit({0x49, 0x89, 0x07});                 // mov [r15], rax
+            emit({0x48, 0x83, 0xeb, 0x08});           // sub rbx, 8
+            endInline();
+        }
+        else if (code == rFrom || code == rFetch) {
+            beginInline(xt);
+            requireAvailable(1);
+            emit({0x49, 0x8b, 0x07});                 // mov rax, [r15]
+            requireRDepth(1);
+            emit({0x48, 0x8b, 0x08});                 // mov rcx, [rax]
+            if (code == rFrom) {
+                emit({0x48, 0x83, 0xe8, 0x08});       // sub rax, 8
+                emit({0x49, 0x89, 0x07});             // mov [r15], rax
+            }
+            emit({0x48, 0x83, 0xc3, 0x08});           // add rbx, 8
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+            endInline();
+        }
+        else if (code == loopIndex || code == outerLoopIndex) {
+            beginInline(xt);
+            requireAvailable(1);
+            emit({0x49, 0x8b, 0x07});                 // mov rax, [r15]
+            if (code == loopIndex) {
+                requireRDepth(2);
+                emit({0x48, 0x8b, 0x08});             // mov rcx, [rax]
+            }
+            else {
+                requireRDepth(4);
+                emit({0x48, 0x8b, 0x48, 0xf0});       // mov rcx, [rax - 16]
+            }
+            emit({0x48, 0x83, 0xc3, 0x08});           // add rbx, 8
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+            endInline();
+        }
+        else if (code == doDo) {
+            beginInline(xt);
+            requireDepth(2);
+            emitDo();
+            endInline();
+        }
+        else if (code == unloop) {
+            beginInline(xt);
+            emit({0x49, 0x8b, 0x07});                 // mov rax, [r15]
+            requireRDepth(2);
+            emitUnloop();
+            endInline();
+        }
+        else if (code == fetch) {
+            beginInline(xt);
+            requireDepth(1);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            requireAligned();
+            emit({0x48, 0x8b, 0x00});                 // mov rax, [rax]
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == store) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            requireAligned();
+            emit({0x48, 0x8b, 0x4b, 0xf8});           // mov rcx, [rbx - 8]
+            emit({0x48, 0x89, 0x08});                 // mov [rax], rcx
+            emit({0x48, 0x83, 0xeb, 0x10});           // sub rbx, 16
+            endInline();
+        }
+        else if (code == cfetch) {
+            beginInline(xt);
+            requireDepth(1);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x0f, 0xb6, 0x00});                 // movzx eax, byte [rax]
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == cstore) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x48, 0x8b, 0x4b, 0xf8});           // mov rcx, [rbx - 8]
+            emit({0x88, 0x08});                       // mov [rax], cl
+            emit({0x48, 0x83, 0xeb, 0x10});           // sub rbx, 16
+            endInline();
+        }
+        else if (code == cells) {
+            beginInline(xt);
+            requireDepth(1);
+            emit({0x48, 0xc1, 0x23, 0x03});           // shl qword [rbx], 3
+            endInline();
+        }
+        else if (code == star) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x48, 0x83, 0xeb, 0x08});           // sub rbx, 8
+            emit({0x48, 0x0f, 0xaf, 0x03});           // imul rax, [rbx]
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == swapDrop || code == nip) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x48, 0x83, 0xeb, 0x08});           // sub rbx, 8
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == overOver || code == twoDup) {
+            beginInline(xt);
+            requireDepth(2);
+            requireAvailable(2);
+            emit({0x48, 0x8b, 0x43, 0xf8});           // mov rax, [rbx - 8]
+            emit({0x48, 0x8b, 0x0b});                 // mov rcx, [rbx]
+            emit({0x48, 0x83, 0xc3, 0x10});           // add rbx, 16
+            emit({0x48, 0x89, 0x43, 0xf8});           // mov [rbx - 8], rax
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+            endInline();
+        }
+        else if (code == fetchPlus) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            requireAligned();
+            emit({0x48, 0x8b, 0x00});                 // mov rax, [rax]
+            emit({0x48, 0x83, 0xeb, 0x08});           // sub rbx, 8
+            emit({0x48, 0x01, 0x03});                 // add [rbx], rax
+            endInline();
+        }
+        else if (code == over) {
+            beginInline(xt);
+            requireDepth(2);
+            requireAvailable(1);
+            emit({0x48, 0x8b, 0x43, 0xf8});           // mov rax, [rbx - 8]
+            emit({0x48, 0x83, 0xc3, 0x08});           // add rbx, 8
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == rot) {
+            beginInline(xt);
+            requireDepth(3);
+            emit({0x48, 0x8b, 0x43, 0xf0});           // mov rax, [rbx - 16]
+            emit({0x48, 0x8b, 0x4b, 0xf8});           // mov rcx, [rbx - 8]
+            emit({0x48, 0x89, 0x4b, 0xf0});           // mov [rbx - 16], rcx
+            emit({0x48, 0x8b, 0x0b});                 // mov rcx, [rbx]
+            emit({0x48, 0x89, 0x4b, 0xf8});           // mov [rbx - 8], rcx
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == tuck) {
+            beginInline(xt);
+            requireDepth(2);
+            requireAvailable(1);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            emit({0x48, 0x8b, 0x4b, 0xf8});           // mov rcx, [rbx - 8]
+            emit({0x48, 0x89, 0x43, 0xf8});           // mov [rbx - 8], rax
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+            emit({0x48, 0x83, 0xc3, 0x08});           // add rbx, 8
+            emit({0x48, 0x89, 0x03});                 // mov [rbx], rax
+            endInline();
+        }
+        else if (code == twoDrop) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x83, 0xeb, 0x10});           // sub rbx, 16
+            endInline();
+        }
+        else if (code == plusStore) {
+            beginInline(xt);
+            requireDepth(2);
+            emit({0x48, 0x8b, 0x03});                 // mov rax, [rbx]
+            requireAligned();
+            emit({0x48, 0x8b, 0x4b, 0xf8});           // mov rcx, [rbx - 8]
+            emit({0x48, 0x01, 0x08});                 // add [rax], rcx
+            emit({0x48, 0x83, 0xeb, 0x10});           // sub rbx, 16
+            endInline();
+        }
+        else if (code == zeroEquals) {
+            beginInline(xt);
+            requireDepth(1);
+            emit({0x31, 0xc9});                       // xor ecx, ecx
+            emit({0x48, 0x83, 0x3b, 0x00});           // cmp qword [rbx], 0
+            emit({0x0f, 0x94, 0xc1});                 // sete cl
+            emit({0x48, 0xf7, 0xd9});                 // neg rcx
+            emit({0x48, 0x89, 0x0b});                 // mov [rbx], rcx
+            endInline();
+        }
+        else if (code == onePlus)    emitUnary(xt, {0x48, 0x83, 0x03, 0x01});  // add qword [rbx], 1
+        else if (code == oneMinus)   emitUnary(xt, {0x48, 0x83, 0x2b, 0x01});  // sub qword [rbx], 1
+        else if (code == twoStar)    emitUnary(xt, {0x48, 0xd1, 0x23});        // shl qword [rbx], 1
+        else if (code == twoSlash)   emitUnary(xt, {0x48, 0xd1, 0x2b});        // shr qword [rbx], 1
+        else if (code == negate)     emitUnary(xt, {0x48, 0xf7, 0x1b});        // neg qword [rbx]
+        else if (code == invert)     emitUnary(xt, {0x48, 0xf7, 0x13});        // not qword [rbx]
+        else if (code == zeroLess)   emitUnary(xt, {0x48, 0xc1, 0x3b, 0x3f});  // sar qword [rbx], 63
+        else if (code == plus)       emitBinary(xt, 0x01);   // add
+        else if (code == minus)      emitBinary(xt, 0x29);   // sub
+        else if (code == bitwiseAnd) emitBinary(xt, 0x21);   // and
+        else if (code == bitwiseOr)  emitBinary(xt, 0x09);   // or
+        else if (code == bitwiseXor) emitBinary(xt, 0x31);   // xor
+        else if (code == equals)     emitCompare(xt, 0x94);  // sete
+        else if (code == lessThan)   emitCompare(xt, 0x9c);  // setl
+        else if (code == uLessThan)  emitCompare(xt, 0x92);  // setb
+        else if (code == greaterThan) emitCompare(xt, 0x9f); // setg
+        else if (code == notEquals)  emitCompare(xt, 0x95);  // setne
+        else if (code == lshift)     emitShift(xt, 0x23);    // shl
+        else if (code == rshift)     emitShift(xt, 0x2b);    // shr
+        else
+            return false;
+        return true;
+    }
+
+    // Emit the slow paths and the unwind code at the end of the definition.
+    void finish() {
+        for (auto& slowPath: slowPaths) {
+            if (slowPath.jumps.empty())
+                continue;
+            for (auto jump: slowPath.jumps)
+                patchRel32(jump, code.size());
+            emitHelperCall(slowPath.function, slowPath.argument);
+            emit({0xe9});                             // jmp resume
+            patchRel32(emitRel32(), slowPath.resume);
+        }
+
+        auto unwind = code.size();
+        emit({0x48, 0x83, 0xc4, 0x08});               // add rsp, 8
+        emit({0xb8}); emit32(1);                      // mov eax, 1
+        emit({0xc3});                                 // ret
+        for (auto jump: unwindJumps)
+            patchRel32(jump, unwind);
+    }
+};
+
+#endif // CXXFORTH_JIT
+
+/****
+
+### Register Allocation
+
+The inline code in the checked translations keeps every item on the data
+stack in memory, so `SWAP` is two loads and two stores, and `+` loads both
+operands and stores the sum.  An unchecked translation doesn't have to check
+each instruction's stack effect, so it can do better.  Its instructions are
+divided into _segments_ at branch targets, and at any instruction that the
+code below doesn't understand: calls, `EXIT`, and the counted-loop words.
+Each segment is lowered to a small intermediate representation, the _IR_,
+whose instructions operate on numbered _values_ rather than on the stack.
+
+While lowering a segment, the `RegisterCompiler` keeps an abstract stack of
+value numbers.  Popping an empty abstract stack produces a `Load` of the next
+cell in memory, and the literals produce constant values, which don't need
+instructions at all.  So the stack shuffling words generate no IR: `SWAP`
+just exchanges two value numbers, and `DUP` pushes the same value twice.
+Arithmetic on two constants is folded, and constant operands become immediate
+operands of the machine instructions.  At the end of a segment, each value on
+the abstract stack is stored in its place in memory, unless it was loaded from
+that place, and `rbx` is adjusted once.  A `(zbranch)` ends its segment with
+a compare-and-jump, which tests the comparison that produced the flag, if
+there is one, rather than the flag itself.
+
+Each value is defined once, so there is no need for a data-flow analysis.
+Instructions that have no effect other than defining a value that nothing
+uses are removed, and then the values are assigned to the scratch registers
+`rdx`, `rsi`, `rdi`, and `r8` through `r11` in a single linear scan, a value's
+register being freed at its last use.  (`rax` and `rcx` are kept for
+temporaries.)  Values don't live beyond their segment, so there are never
+more than a few.  If they don't fit anyway, the segment is emitted with the
+usual inline code instead.
+
+The data stack needs no checks here, but the alignment of `@` and `!`
+addresses and the return stack are checked as before.  The items on the data
+stack are not all in memory when a check fails, so the slow path just reports
+the error rather than executing the C++ primitive.
+
+Because a segment's instructions are reordered and merged, only its first
+instruction has a corresponding address in the machine code.  That's enough
+for tiered execution, which only starts native code at the start of the
+definition or at a branch target.
+
+****/
+
+#ifdef CXXFORTH_JIT
+
+// An operation of the register IR.
+enum class IrOp {
+    Load,          // result = the cell at slot n of the data stack
+    Add, Sub, And, Or, Xor, Mul, Shl, Shr,  // result = a op b
+    Compare,       // result = a cc b ? True : False, where n is the condition code
+    Neg, Not,      // result = op a
+    Fetch,         // result = cell at address a
+    CFetch,        // result = character at address a
+    Store,         // cell at address a = b
+    CStore,        // character at address a = b
+    PlusStore,     // cell at address a += b
+    ToR,           // push a onto the return stack
+    RFrom,         // result = popped from the return stack
+    RFetch,        // result = top of the return stack
+    LoopIndex,     // result = I
+    OuterLoopIndex, // result = J
+    Do,            // push loop parameters: limit a and index b
+    Unloop,        // drop loop parameters
+    StoreSlot,     // slot n of the data stack = a
+    Adjust,        // move rbx by n cells
+    Branch         // jump to the target unless a cc b, where n is cc
+};
+
+struct IrInstruction {
+    IrOp  op;
+    int   result;           // value defined, or -1
+    int   a, b;             // operand values, or -1
+    SCell n;                // slot, condition code, or cell count
+    bool  dead = false;
+};
+
+// A value of the register IR, which is either a constant or the result of
+// an instruction.  Slots are numbered relative to the top of the stack at
+// the start of the segment, so the top is slot 0 and the next is slot -1.
+struct IrValue {
+    bool  constant;
+    Cell  value;            // the constant
+    bool  loaded;           // whether it's the result of a Load
+    SCell slot;             // the slot loaded
+    int   reg = -1;         // register assigned
+    int   lastUse = -1;     // index of the last instruction using it
+};
+
+// x86-64 condition codes, as used in the low nibble of setcc and jcc.
+enum : SCell { CondBelow = 0x2, CondEqual = 0x4, CondNotEqual = 0x5, CondLess = 0xc, CondGreater = 0xf };
+
+// Register numbers.
+enum : Char { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R10 = 10, R11 = 11 };
+
+// Lowers segments of an unchecked translation to the IR and emits them.
+// Instructions that can't be lowered are emitted by emitInstruction.
+class RegisterCompiler {
+public:
+    using Emitter = std::function<void(const Instruction&)>;
+
+    RegisterCompiler(NativeCompiler& c, Emitter e,
+                     std::unordered_map<AAddr, size_t>& p,
+                     std::vector<std::pair<size_t, AAddr>>& f):
+        compiler(c), emitInstruction(e), positions(p), branchFixups(f) {}
+
+    // Translate an instruction.  A branch target must start a new segment.
+    void compile(const Instruction& instruction, bool isTarget) {
+        if (isTarget)
+            flush();
+        auto xt = instruction.xt;
+        auto comparison = branchComparison(xt);
+        if (xt == zbranchXt || xt == dupZbranchXt || comparison != nullptr) {
+            if (comparison != nullptr)
+                lowerPrimitive(comparison->code);
+            auto flag = pop();
+            if (xt == dupZbranchXt)
+                stack.push_back(flag);
+            branchFlag = flag;
+            branchTarget = instruction.target;
+            pending.push_back(&instruction);
+            flush();
+        }
+        else if (canLower(instruction)) {
+            lower(instruction);
+            pending.push_back(&instruction);
+        }
+        else {
+            flush();
+            emitInstruction(instruction);
+        }
+    }
+
+    // Emit the current segment.
+    void flush() {
+        if (pending.empty())
+            return;
+
+        auto depth = static_cast<SCell>(stack.size());
+        for (SCell i = 0; i < depth; ++i) {
+            auto slot = i + 1 - consumed;
+            auto value = stack[i];
+            if (!values[value].loaded || values[value].slot != slot)
+                add(IrOp::StoreSlot, -1, value, -1, slot);
+        }
+        add(IrOp::Adjust, -1, -1, -1, depth - consumed);
+        if (branchTarget != nullptr)
+            addBranch();
+
+        removeDeadCode();
+        auto start = compiler.code.size();
+        if (allocate()) {
+            for (auto instruction: pending)
+                positions[instruction->address] = start;
+            for (auto& instruction: ir) {
+                if (!instruction.dead)
+                    generate(instruction);
+            }
+        }
+        else {
+            for (auto instruction: pending)
+                emitInstruction(*instruction);
+        }
+
+        pending.clear();
+        ir.clear();
+        values.clear();
+        stack.clear();
+        consumed = 0;
+        branchTarget = nullptr;
+    }
+
+private:
+    NativeCompiler& compiler;
+    Emitter emitInstruction;
+    std::unordered_map<AAddr, size_t>& positions;
+    std::vector<std::pair<size_t, AAddr>>& branchFixups;
+
+    std::vector<const Instruction*> pending;   // the segment's instructions
+    std::vector<IrInstruction> ir;
+    std::vector<IrValue> values;
+    std::vector<int> stack;                    // the abstract stack
+    SCell consumed = 0;                        // number of slots popped
+    int branchFlag = -1;
+    AAddr branchTarget = nullptr;
+
+    static constexpr Char registerPool[] = {RDX, RSI, RDI, R8, R9, R10, R11};
+
+    /*** Lowering ***/
+
+    int constant(Cell value) {
+        values.push_back(IrValue{true, value, false, 0});
+        return static_cast<int>(values.size() - 1);
+    }
+
+    int add(IrOp op, int result, int a, int b, SCell n = 0) {
+        ir.push_back(IrInstruction{op, result, a, b, n});
+        return result;
+    }
+
+    // Add an instruction that defines a new value.
+    int define(IrOp op, int a = -1, int b = -1, SCell n = 0) {
+        values.push_back(IrValue{false, 0, false, 0});
+        return add(op, static_cast<int>(values.size() - 1), a, b, n);
+    }
+
+    int load(SCell slot) {
+        auto value = define(IrOp::Load, -1, -1, slot);
+        values[value].loaded = true;
+        values[value].slot = slot;
+        return value;
+    }
+
+    int pop() {
+        if (stack.empty())
+            return load(-consumed++);
+        auto value = stack.back();
+        stack.pop_back();
+        return value;
+    }
+
+    void push(int value) { stack.push_back(value); }
+
+    // Return the value n items below the top, without popping anything.
+    int peek(size_t n) {
+        if (n < stack.size())
+            return stack[stack.size() - 1 - n];
+        return load(-consumed - static_cast<SCell>(n - stack.size()));
+    }
+
+    bool isConstant(int value) const { return values[value].constant; }
+
+    int binary(IrOp op, int a, int b) {
+        if (isConstant(a) && isConstant(b)) {
+            auto x = values[a].value, y = values[b].value;
+            switch (op) {
+            case IrOp::Add: return constant(x + y);
+            case IrOp::Sub: return constant(x - y);
+            case IrOp::And: return constant(x & y);
+            case IrOp::Or:  return constant(x | y);
+            case IrOp::Xor: return constant(x ^ y);
+            case IrOp::Mul: return constant(x * y);
+            default: break;
+            }
+        }
+        if ((op == IrOp::Add || op == IrOp::Sub || op == IrOp::Or || op == IrOp::Xor)
+            && isConstant(b) && values[b].value == 0)
+            return a;
+        return define(op, a, b);
+    }
+
+    int compare(int a, int b, SCell cc) {
+        if (isConstant(a) && isConstant(b)) {
+            auto x = values[a].value, y = values[b].value;
+            auto sx = static_cast<SCell>(x), sy = static_cast<SCell>(y);
+            switch (cc) {
+            case CondEqual:    return constant(x == y ? True : False);
+            case CondNotEqual: return constant(x != y ? True : False);
+            case CondLess:     return constant(sx < sy ? True : False);
+            case CondGreater:  return constant(sx > sy ? True : False);
+            case CondBelow:    return constant(x < y ? True : False);
+            }
+        }
+        return define(IrOp::Compare, a, b, cc);
+    }
+
+    int unary(IrOp op, int a) {
+        if (isConstant(a))
+            return constant(op == IrOp::Neg ? -values[a].value : ~values[a].value);
+        return define(op, a);
+    }
+
+    // Return true if the primitive at code can be lowered.
+    static bool canLowerPrimitive(Code code) {
+        static const std::set<Code> primitives{
+            drop, dup, swap, over, rot, nip, tuck, twoDup, twoDrop, overOver, swapDrop,
+            plus, minus, bitwiseAnd, bitwiseOr, bitwiseXor, star, lshift, rshift,
+            equals, notEquals, lessThan, greaterThan, uLessThan, zeroEquals, zeroLess,
+            onePlus, oneMinus, twoStar, twoSlash, cells, negate, invert,
+            fetch, cfetch, store, cstore, plusStore, fetchPlus,
+            toR, rFrom, rFetch, loopIndex, outerLoopIndex, doDo, unloop
+        };
+        return primitives.count(code) != 0;
+    }
+
+    bool canLower(const Instruction& instruction) const {
+        auto xt = instruction.xt;
+        if (xt == doLiteralXt || xt == litPlusXt || xt == litEqualsXt || xt->code == doValue
+                || xt->code == doField || xt == localFetchXt || xt == localStoreXt)
+            return true;
+        if (xt->code == pick)
+            return !stack.empty() && values[stack.back()].constant
+                && values[stack.back()].value < 64;
+        if (xt->code == doFused) {
+            for (auto word = xt->parameter; *word != 0; ++word) {
+                if (!canLowerPrimitive(XT(*word)->code))
+                    return false;
+            }
+            return true;
+        }
+        return canLowerPrimitive(xt->code);
+    }
+
+    // Return the address of local i.
+    int localAddress(Cell i) {
+        auto frame = define(IrOp::Fetch, constant(CELL(&localFrame)));
+        return binary(IrOp::Add, frame, constant(i * CellSize));
+    }
+
+    void lower(const Instruction& instruction) {
+        auto xt = instruction.xt;
+        if (xt == doLiteralXt)
+            push(constant(instruction.operand));
+        else if (xt == litPlusXt)
+            push(binary(IrOp::Add, pop(), constant(instruction.operand)));
+        else if (xt == litEqualsXt)
+            push(compare(pop(), constant(instruction.operand), CondEqual));
+        else if (xt->code == doValue)
+            push(define(IrOp::Fetch, constant(CELL(xt->parameter))));
+        else if (xt->code == doField)
+            push(binary(IrOp::Add, pop(), constant(*xt->parameter)));
+        else if (xt == localFetchXt)
+            push(define(IrOp::Fetch, localAddress(instruction.operand)));
+        else if (xt == localStoreXt) {
+            auto x = pop();
+            add(IrOp::Store, -1, localAddress(instruction.operand), x);
+        }
+        else if (xt->code == doFused) {
+            for (auto word = xt->parameter; *word != 0; ++word)
+                lowerPrimitive(XT(*word)->code);
+        }
+        else
+            lowerPrimitive(xt->code);
+    }
+
+    void lowerPrimitive(Code code) {
+        if (code == drop) {
+            pop();
+        }
+        else if (code == dup) {
+            auto x = pop(); push(x); push(x);
+        }
+        else if (code == swap) {
+            auto x2 = pop(), x1 = pop(); push(x2); push(x1);
+        }
+        else if (code == over) {
+            auto x2 = pop(), x1 = pop(); push(x1); push(x2); push(x1);
+        }
+        else if (code == rot) {
+            auto x3 = pop(), x2 = pop(), x1 = pop(); push(x2); push(x3); push(x1);
+        }
+        else if (code == nip || code == swapDrop) {
+            auto x2 = pop(); pop(); push(x2);
+        }
+        else if (code == tuck) {
+            auto x2 = pop(), x1 = pop(); push(x2); push(x1); push(x2);
+        }
+        else if (code == twoDup || code == overOver) {
+            auto x2 = pop(), x1 = pop(); push(x1); push(x2); push(x1); push(x2);
+        }
+        else if (code == twoDrop) {
+            pop(); pop();
+        }
+        else if (code == pick) {
+            auto n = values[pop()].value;
+            push(peek(n));
+        }
+        else if (code == zeroEquals) push(compare(pop(), constant(0), CondEqual));
+        else if (code == zeroLess)   push(compare(pop(), constant(0), CondLess));
+        else if (code == onePlus)    push(binary(IrOp::Add, pop(), constant(1)));
+        else if (code == oneMinus)   push(binary(IrOp::Sub, pop(), constant(1)));
+        else if (code == twoStar)    push(define(IrOp::Shl, pop(), constant(1)));
+        else if (code == twoSlash)   push(define(IrOp::Shr, pop(), constant(1)));
+        else if (code == cells)      push(define(IrOp::Shl, pop(), constant(3)));
+        else if (code == negate)     push(unary(IrOp::Neg, pop()));
+        else if (code == invert)     push(unary(IrOp::Not, pop()));
+        else if (code == fetch)      push(define(IrOp::Fetch, pop()));
+        else if (code == cfetch)     push(define(IrOp::CFetch, pop()));
+        else if (code == store || code == cstore || code == plusStore) {
+            auto address = pop(), x = pop();
+            add(code == store ? IrOp::Store : code == cstore ? IrOp::CStore : IrOp::PlusStore,
+                -1, address, x);
+        }
+        else if (code == fetchPlus) {
+            auto address = pop(), n = pop();
+            push(binary(IrOp::Add, n, define(IrOp::Fetch, address)));
+        }
+        else if (code == toR)            add(IrOp::ToR, -1, pop(), -1);
+        else if (code == rFrom)          push(define(IrOp::RFrom));
+        else if (code == rFetch)         push(define(IrOp::RFetch));
+        else if (code == loopIndex)      push(define(IrOp::LoopIndex));
+        else if (code == outerLoopIndex) push(define(IrOp::OuterLoopIndex));
+        else if (code == doDo) {
+            auto index = pop(), limit = pop();
+            add(IrOp::Do, -1, limit, index);
+        }
+        else if (code == unloop) {
+            add(IrOp::Unloop, -1, -1, -1);
+        }
+        else {
+            static const std::map<Code, IrOp> binaries{
+                {plus, IrOp::Add}, {minus, IrOp::Sub}, {bitwiseAnd, IrOp::And},
+                {bitwiseOr, IrOp::Or}, {bitwiseXor, IrOp::Xor}, {star, IrOp::Mul},
+                {lshift, IrOp::Shl}, {rshift, IrOp::Shr}
+            };
+            static const std::map<Code, SCell> comparisons{
+                {equals, CondEqual}, {notEquals, CondNotEqual}, {lessThan, CondLess},
+                {greaterThan, CondGreater}, {uLessThan, CondBelow}
+            };
+            auto b = pop(), a = pop();
+            auto found = binaries.find(code);
+            if (found != binaries.end())
+                push(binary(found->second, a, b));
+            else
+                push(compare(a, b, comparisons.at(code)));
+        }
+    }
+
+    // Add the branch that ends the segment, testing the comparison that
+    // produced the flag if nothing else uses it.
+    void addBranch() {
+        auto flag = branchFlag;
+        if (!isConstant(flag) && !values[flag].loaded) {
+            auto uses = 0;
+            for (auto& instruction: ir)
+                uses += (instruction.a == flag) + (instruction.b == flag);
+            for (auto& instruction: ir) {
+                if (instruction.result == flag && instruction.op == IrOp::Compare && uses == 0) {
+                    instruction.dead = true;
+                    add(IrOp::Branch, -1, instruction.a, instruction.b, instruction.n);
+                    return;
+                }
+            }
+        }
+        add(IrOp::Branch, -1, flag, constant(0), CondNotEqual);
+    }
+
+    /*** Optimization and register allocation ***/
+
+    static bool isPure(IrOp op) {
+        switch (op) {
+        case IrOp::Load: case IrOp::Add: case IrOp::Sub: case IrOp::And: case IrOp::Or:
+        case IrOp::Xor: case IrOp::Mul: case IrOp::Shl: case IrOp::Shr: case IrOp::Compare:
+        case IrOp::Neg: case IrOp::Not: case IrOp::CFetch:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Remove pure instructions whose results aren't used.  Working backwards
+    // also removes the instructions that only they used.
+    void removeDeadCode() {
+        std::vector<int> uses(values.size());
+        for (auto& instruction: ir) {
+            if (instruction.dead) continue;
+            if (instruction.a >= 0) ++uses[instruction.a];
+            if (instruction.b >= 0) ++uses[instruction.b];
+        }
+        for (auto i = ir.rbegin(); i != ir.rend(); ++i) {
+            if (i->dead || !isPure(i->op) || uses[i->result] != 0)
+                continue;
+            i->dead = true;
+            if (i->a >= 0) --uses[i->a];
+            if (i->b >= 0) --uses[i->b];
+        }
+    }
+
+    // Assign registers to the values, in a linear scan.  Returns false if
+    // there aren't enough.
+    bool allocate() {
+        for (int i = 0; i < static_cast<int>(ir.size()); ++i) {
+            if (ir[i].dead) continue;
+            if (ir[i].a >= 0) values[ir[i].a].lastUse = i;
+            if (ir[i].b >= 0) values[ir[i].b].lastUse = i;
+        }
+        std::vector<bool> busy(16);
+        for (int i = 0; i < static_cast<int>(ir.size()); ++i) {
+            auto& instruction = ir[i];
+            if (instruction.dead) continue;
+            for (auto operand: {instruction.a, instruction.b}) {
+                if (operand >= 0 && !isConstant(operand) && values[operand].lastUse == i)
+                    busy[values[operand].reg] = false;
+            }
+            if (instruction.result < 0)
+                continue;
+            auto& result = values[instruction.result];
+            for (auto reg: registerPool) {
+                if (!busy[reg]) {
+                    result.reg = reg;
+                    busy[reg] = true;
+                    break;
+                }
+            }
+            if (result.reg < 0)
+                return false;
+            if (result.lastUse < i)
+                busy[result.reg] = false;
+        }
+        return true;
+    }
+
+    /*** Code generation ***/
+
+    void emit(std::initializer_list<Char> bytes) { compiler.emit(bytes); }
+    void emit32(SCell value) { compiler.emit32(static_cast<uint32_t>(value)); }
+
+    static bool fitsInt32(SCell n) { return INT32_MIN <= n && n <= INT32_MAX; }
+    static bool fitsInt8(SCell n)  { return -128 <= n && n <= 127; }
+
+    bool isImmediate(int value) const {
+        return isConstant(value) && fitsInt32(static_cast<SCell>(values[value].value));
+    }
+    SCell immediate(int value) const { return static_cast<SCell>(values[value].value); }
+
+    // Emit a REX prefix with W set, for the reg and r/m registers.
+    void emitRexW(Char reg, Char rm) {
+        emit({static_cast<Char>(0x48 | ((reg & 8) >> 1) | ((rm & 8) >> 3))});
+    }
+
+    void emitModRM(Char mod, Char reg, Char rm) {
+        emit({static_cast<Char>((mod << 6) | ((reg & 7) << 3) | (rm & 7))});
+    }
+
+    // Emit opcode with a register r/m operand.
+    void emitRegister(Char opcode, Char reg, Char rm) {
+        emitRexW(reg, rm); emit({opcode}); emitModRM(3, reg, rm);
+    }
+
+    // Emit opcode with the r/m operand [base].  base must not be rsp, rbp,
+    // r12, or r13, which need other encodings.
+    void emitIndirect(Char opcode, Char reg, Char base) {
+        emitRexW(reg, base); emit({opcode}); emitModRM(0, reg, base);
+    }
+
+    // Emit opcode with the r/m operand [rbx + slot*8].
+    void emitSlot(Char opcode, Char reg, SCell slot) {
+        auto disp = slot * static_cast<SCell>(CellSize);
+        emitRexW(reg, RBX); emit({opcode});
+        if (fitsInt8(disp)) {
+            emitModRM(1, reg, RBX); emit({static_cast<Char>(disp)});
+        }
+        else {
+            emitModRM(2, reg, RBX); emit32(disp);
+        }
+    }
+
+    void emitMove(Char dst, Char src) {
+        if (dst != src)
+            emitRegister(0x89, src, dst);             // mov dst, src
+    }
+
+    void emitMoveImmediate(Char dst, Cell value) {
+        auto svalue = static_cast<SCell>(value);
+        if (fitsInt32(svalue)) {
+            emitRegister(0xc7, 0, dst); emit32(svalue); // mov dst, value
+        }
+        else {
+            emit({static_cast<Char>(0x48 | ((dst & 8) >> 3)), static_cast<Char>(0xb8 + (dst & 7))});
+            compiler.emit64(value);                   // mov dst, value
+        }
+    }
+
+    // Return the register holding value, loading a constant into scratch.
+    Char use(int value, Char scratch) {
+        if (isConstant(value)) {
+            emitMoveImmediate(scratch, values[value].value);
+            return scratch;
+        }
+        return static_cast<Char>(values[value].reg);
+    }
+
+    Char reg(int value) const { return static_cast<Char>(values[value].reg); }
+
+    // Emit an arithmetic instruction with an immediate operand, using the
+    // 0x81 or 0x83 opcode extension ext.
+    void emitArithmeticImmediate(Char ext, Char dst, SCell n) {
+        if (fitsInt8(n)) {
+            emitRegister(0x83, ext, dst); emit({static_cast<Char>(n)});
+        }
+        else {
+            emitRegister(0x81, ext, dst); emit32(n);
+        }
+    }
+
+    // Emit dst = a op b for an operation with a two-operand form, where
+    // operate(dst, src) emits dst = dst op src and operateImmediate(dst,
+    // src, n) emits dst = src op n.
+    template<typename Operate, typename OperateImmediate>
+    void emitTwoOperand(Char dst, int a, int b, bool commutative,
+                        Operate operate, OperateImmediate operateImmediate) {
+        if (commutative && isConstant(a) && !isConstant(b))
+            std::swap(a, b);
+        if (isImmediate(b)) {
+            operateImmediate(dst, use(a, RAX), immediate(b));
+            return;
+        }
+        auto rb = use(b, RCX);
+        auto ra = use(a, RAX);
+        if (dst == ra) {
+            operate(dst, rb);
+        }
+        else if (dst != rb) {
+            emitMove(dst, ra);
+            operate(dst, rb);
+        }
+        else {
+            emitMove(RAX, ra);
+            operate(RAX, rb);
+            emitMove(dst, RAX);
+        }
+    }
+
+    void emitArithmetic(Char opcode, Char ext, Char dst, int a, int b, bool commutative) {
+        emitTwoOperand(dst, a, b, commutative,
+            [=](Char d, Char s) { emitRegister(opcode, s, d); },          // op d, s
+            [=](Char d, Char s, SCell n) { emitMove(d, s); emitArithmeticImmediate(ext, d, n); });
+    }
+
+    void emitMultiply(Char dst, int a, int b) {
+        emitTwoOperand(dst, a, b, true,
+            [=](Char d, Char s) {                                         // imul d, s
+                emitRexW(d, s); emit({0x0f, 0xaf}); emitModRM(3, d, s);
+            },
+            [=](Char d, Char s, SCell n) {                                // imul d, s, n
+                if (fitsInt8(n)) {
+                    emitRegister(0x6b, d, s); emit({static_cast<Char>(n)});
+                }
+                else {
+                    emitRegister(0x69, d, s); emit32(n);
+                }
+            });
+    }
+
+    // Emit a shift, using the opcode extension for shl or shr.
+    void emitShift(Char ext, Char dst, int a, int b) {
+        if (isConstant(b)) {
+            emitMove(dst, use(a, RAX));
+            emitRegister(0xc1, ext, dst);             // shl/shr dst, n
+            emit({static_cast<Char>(values[b].value & 63)});
+        }
+        else {
+            emitMove(RCX, reg(b));
+            emitMove(RAX, use(a, RAX));
+            emitRegister(0xd3, ext, RAX);             // shl/shr rax, cl
+            emitMove(dst, RAX);
+        }
+    }
+
+    void emitCompare(int a, int b) {
+        if (isImmediate(b)) {
+            auto ra = use(a, RAX);
+            if (immediate(b) == 0)
+                emitRegister(0x85, ra, ra);           // test ra, ra
+            else
+                emitArithmeticImmediate(7, ra, immediate(b)); // cmp ra, b
+        }
+        else {
+            auto rb = use(b, RCX);
+            emitRegister(0x39, rb, use(a, RAX));      // cmp ra, rb
+        }
+    }
+
+#ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
+
+    void requireAligned(Char, const char*) {}
+    void requireRDepth(size_t, const char*, SCell) {}
+    void requireRAvailable(const char*) {}
+
+#else
+
+    // Check that the address in reg is cell-aligned.
+    void requireAligned(Char reg, const char* message) {
+        compiler.beginFailure(message, ThrowUnalignedAddress);
+        emitRegister(0xf7, 0, reg); emit32(CellSize - 1); // test reg, 7
+        compiler.emitCheck(0x85);                     // jnz slow
+        compiler.endInline();
+    }
+
+    // Check that the return stack holds at least n cells, given rTop in rax.
+    void requireRDepth(size_t n, const char* message, SCell code) {
+        compiler.beginFailure(message, code);
+        emitMoveImmediate(RCX, CELL(rStack + n - 1)); // mov rcx, rStack + n - 1
+        emit({0x48, 0x39, 0xc8});                     // cmp rax, rcx
+        compiler.emitCheck(0x82);                     // jb slow
+        compiler.endInline();
+    }
+
+    // Check that the return stack has room for the cell at rax.
+    void requireRAvailable(const char* message) {
+        if (!needsAvailableCheck(1)) return;
+        compiler.beginFailure(message, ThrowReturnStackOverflow);
+        emitMoveImmediate(RCX, CELL(rStackLimit));    // mov rcx, rStackLimit
+        emit({0x48, 0x39, 0xc8});                     // cmp rax, rcx
+        compiler.emitCheck(0x83);                     // jae slow
+        compiler.endInline();
+    }
+
+#endif // CXXFORTH_SKIP_RUNTIME_CHECKS
+
+    // Emit mov [rax + disp8], value.
+    void emitStoreAtRax(int value, SCell disp) {
+        if (isImmediate(value)) {
+            emitRexW(0, RAX); emit({0xc7}); emitModRM(1, 0, RAX);
+            emit({static_cast<Char>(disp)}); emit32(immediate(value));
+        }
+        else {
+            auto rv = use(value, RCX);
+            emitRexW(rv, RAX); emit({0x89}); emitModRM(1, rv, RAX);
+            emit({static_cast<Char>(disp)});
+        }
+    }
+
+    void emitLoadRTop()  { emit({0x49, 0x8b, 0x07}); } // mov rax, [r15]
+    void emitStoreRTop() { emit({0x49, 0x89, 0x07}); } // mov [r15], rax
+
+    void generate(const IrInstruction& instruction) {
+        auto a = instruction.a, b = instruction.b;
+        auto dst = instruction.result >= 0 ? reg(instruction.result) : RAX;
+        switch (instruction.op) {
+        case IrOp::Load:
+            emitSlot(0x8b, dst, instruction.n);       // mov dst, [rbx + slot*8]
+            break;
+        case IrOp::Add: emitArithmetic(0x01, 0, dst, a, b, true);  break;
+        case IrOp::Sub: emitArithmetic(0x29, 5, dst, a, b, false); break;
+        case IrOp::And: emitArithmetic(0x21, 4, dst, a, b, true);  break;
+        case IrOp::Or:  emitArithmetic(0x09, 1, dst, a, b, true);  break;
+        case IrOp::Xor: emitArithmetic(0x31, 6, dst, a, b, true);  break;
+        case IrOp::Mul: emitMultiply(dst, a, b); break;
+        case IrOp::Shl: emitShift(4, dst, a, b); break;
+        case IrOp::Shr: emitShift(5, dst, a, b); break;
+        case IrOp::Compare:
+            emitCompare(a, b);
+            emit({0x0f, static_cast<Char>(0x90 | instruction.n), 0xc0}); // setcc al
+            emit({0x0f, 0xb6, 0xc0});                 // movzx eax, al
+            emit({0x48, 0xf7, 0xd8});                 // neg rax
+            emitMove(dst, RAX);
+            break;
+        case IrOp::Neg:
+        case IrOp::Not:
+            emitMove(dst, use(a, RAX));
+            emitRegister(0xf7, instruction.op == IrOp::Neg ? 3 : 2, dst); // neg/not dst
+            break;
+        case IrOp::Fetch: {
+            auto address = use(a, RAX);
+            requireAligned(address, "@: unaligned address");
+            emitIndirect(0x8b, dst, address);         // mov dst, [address]
+            break;
+        }
+        case IrOp::CFetch: {
+            auto address = use(a, RAX);
+            if ((dst | address) & 8)
+                emit({static_cast<Char>(0x40 | ((dst & 8) >> 1) | ((address & 8) >> 3))});
+            emit({0x0f, 0xb6}); emitModRM(0, dst, address); // movzx dst, byte [address]
+            break;
+        }
+        case IrOp::Store:
+        case IrOp::PlusStore: {
+            auto address = use(a, RAX);
+            auto isStore = instruction.op == IrOp::Store;
+            requireAligned(address, isStore ? "!: unaligned address" : "+!: unaligned address");
+            if (isImmediate(b)) {
+                emitIndirect(isStore ? 0xc7 : 0x81, 0, address); // mov/add qword [address], b
+                emit32(immediate(b));
+            }
+            else {
+                emitIndirect(isStore ? 0x89 : 0x01, use(b, RCX), address); // mov/add [address], rb
+            }
+            break;
+        }
+        case IrOp::CStore: {
+            auto address = use(a, RAX);
+            if (isConstant(b)) {
+                if (address & 8) emit({0x41});
+                emit({0xc6}); emitModRM(0, 0, address); // mov byte [address], b
+                emit({static_cast<Char>(values[b].value)});
+            }
+            else {
+                auto rb = reg(b);
+                emit({static_cast<Char>(0x40 | ((rb & 8) >> 1) | ((address & 8) >> 3))});
+                emit({0x88}); emitModRM(0, rb, address); // mov [address], rb8
+            }
+            break;
+        }
+        case IrOp::ToR:
+            emitLoadRTop();
+            emit({0x48, 0x83, 0xc0, 0x08});           // add rax, 8
+            requireRAvailable(">R: return stack overflow");
+            emitStoreAtRax(a, 0);                     // mov [rax], a
+            emitStoreRTop();
+            break;
+        case IrOp::RFrom:
+            emitLoadRTop();
+            requireRDepth(1, "R>: return stack underflow", ThrowReturnStackUnderflow);
+            emitIndirect(0x8b, dst, RAX);             // mov dst, [rax]
+            emit({0x48, 0x83, 0xe8, 0x08});           // sub rax, 8
+            emitStoreRTop();
+            break;
+        case IrOp::RFetch:
+        case IrOp::LoopIndex:
+            emitLoadRTop();
+            if (instruction.op == IrOp::RFetch)
+                requireRDepth(1, "R@: return stack underflow", ThrowReturnStackUnderflow);
+            else
+                requireRDepth(2, "I: return stack underflow", ThrowReturnStackUnderflow);
+            emitIndirect(0x8b, dst, RAX);             // mov dst, [rax]
+            break;
+        case IrOp::OuterLoopIndex:
+            emitLoadRTop();
+            requireRDepth(4, "J: return stack underflow", ThrowReturnStackUnderflow);
+            emitRexW(dst, RAX); emit({0x8b}); emitModRM(1, dst, RAX);
+            emit({static_cast<Char>(-2 * static_cast<SCell>(CellSize))}); // mov dst, [rax - 16]
+            break;
+        case IrOp::Do:
+            emitLoadRTop();
+            emit({0x48, 0x83, 0xc0, 0x10});           // add rax, 16
+            requireRAvailable("DO: return stack overflow");
+            emitStoreAtRax(a, -static_cast<SCell>(CellSize)); // mov [rax - 8], limit
+            emitStoreAtRax(b, 0);                     // mov [rax], index
+            emitStoreRTop();
+            break;
+        case IrOp::Unloop:
+            emitLoadRTop();
+            requireRDepth(2, "UNLOOP: return stack underflow", ThrowReturnStackUnderflow);
+            compiler.emitUnloop();
+            break;
+        case IrOp::StoreSlot:
+            if (isImmediate(a)) {
+                emitSlot(0xc7, 0, instruction.n);     // mov qword [rbx + slot*8], a
+                emit32(immediate(a));
+            }
+            else {
+                emitSlot(0x89, use(a, RAX), instruction.n); // mov [rbx + slot*8], ra
+            }
+            break;
+        case IrOp::Adjust:
+            if (instruction.n != 0)
+                emitSlot(0x8d, RBX, instruction.n);   // lea rbx, [rbx + n*8]
+            break;
+        case IrOp::Branch:
+            emitCompare(a, b);
+            emit({0x0f, static_cast<Char>(0x80 | (instruction.n ^ 1))}); // jncc target
+            branchFixups.emplace_back(compiler.emitRel32(), branchTarget);
+            break;
+        }
+    }
+};
+
+constexpr Char RegisterCompiler::registerPool[];
+
+std::set<AAddr> findTargets(AAddr entry, const std::vector<Instruction>& instructions);
+
+// Translate the instructions starting at entry into machine code, with or
+// without data stack checks.  covered is coversCallees() of the definition.
+const NativeWord* compileNative(AAddr entry, bool checked, bool covered) {
+    auto& words = checked ? nativeWords : uncheckedNativeWords;
+    auto found = words.find(entry);
+    if (found != words.end())
+        return &found->second;
+
+    // Return true if a call of xt goes to its unchecked translation.  Checked
+    // code checks xt's stack effect first (see emitUncheckedCall()), but
+    // unchecked code must already cover it; otherwise it calls the checked
+    // translation.
+    auto callsUnchecked = [&](Xt xt) {
+        return hasUncheckedTranslation(xt) && (checked || canCallDirectly(xt, false, covered));
+    };
+
+    // Translate the definitions that this one calls first, so it can call
+    // them directly, skipping any that are already being translated, such as
+    // this one if it is recursive.
+    static std::set<AAddr> inProgress;
+    auto instructions = decodeBody(entry);
+    inProgress.insert(entry);
+    try {
+        for (auto& instruction: instructions) {
+            auto xt = instruction.xt == tailCallXt ? XT(instruction.operand) : instruction.xt;
+            if (xt->code == doDefer) {
+                // See emitDeferredCall().
+                xt = XT(*xt->parameter);
+                if (xt->code == doColon && xt->native == nullptr && inProgress.count(xt->does) == 0)
+                    nativeCode(xt, true);
+                continue;
+            }
+            if (xt->code != doColon || inProgress.count(xt->does) != 0)
+                continue;
+            if (callsUnchecked(xt))
+                nativeCode(xt, false);
+            else if (xt->native == nullptr)
+                nativeCode(xt, true);
+        }
+    }
+    catch (...) {
+        inProgress.erase(entry);
+        throw;
+    }
+    inProgress.erase(entry);
+
+    NativeCompiler compiler(codePointer, checked);
+
+    // Keep the stack 16-byte aligned for calls.
+    compiler.emit({0x48, 0x83, 0xec, 0x08});                     // sub rsp, 8
+
+    std::unordered_map<AAddr, size_t> positions;
+    std::vector<std::pair<size_t, AAddr>> branchFixups;
+
+    auto emitInstruction = [&](const Instruction& instruction) {
+        positions[instruction.address] = compiler.code.size();
+
+        auto xt = instruction.xt;
+        if (xt == exitXt) {
+            compiler.emitExit();
+        }
+        else if (xt == doLiteralXt) {
+            compiler.emitLiteral(instruction.operand);
+        }
+        else if (xt == branchXt) {
+            compiler.emit({0xe9});                               // jmp target
+            branchFixups.emplace_back(compiler.emitRel32(), instruction.target);
+        }
+        else if (xt == zbranchXt || branchComparison(xt) != nullptr) {
+            // A fused comparison and branch is emitted as the comparison
+            // followed by (zbranch).
+            auto comparison = branchComparison(xt);
+            if (comparison != nullptr && !compiler.emitPrimitive(comparison))
+                compiler.emitExecute(comparison);
+            compiler.beginFailure("(zbranch): stack underflow", ThrowStackUnderflow);
+            compiler.requireDepth(1);
+            compiler.emit({0x48, 0x8b, 0x03});                   // mov rax, [rbx]
+            compiler.emit({0x48, 0x83, 0xeb, 0x08});             // sub rbx, 8
+            compiler.emit({0x48, 0x85, 0xc0});                   // test rax, rax
+            compiler.endInline();
+            compiler.emit({0x0f, 0x84});                         // jz target
+            branchFixups.emplace_back(compiler.emitRel32(), instruction.target);
+        }
+        else if (xt == dupZbranchXt) {
+            compiler.beginFailure("DUP: stack underflow", ThrowStackUnderflow);
+            compiler.requireDepth(1);
+            compiler.emit({0x48, 0x83, 0x3b, 0x00});             // cmp qword [rbx], 0
+            compiler.endInline();
+            compiler.emit({0x0f, 0x84});                         // jz target
+            branchFixups.emplace_back(compiler.emitRel32(), instruction.target);
+        }
+        else if (xt == qdoXt) {
+            compiler.beginFailure("?DO: stack underflow", ThrowStackUnderflow);
+            compiler.requireDepth(2);
+            compiler.endInline();
+            compiler.emit({0x48, 0x8b, 0x03});                   // mov rax, [rbx]
+            compiler.emit({0x48, 0x3b, 0x43, 0xf8});             // cmp rax, [rbx - 8]
+            compiler.emit({0x0f, 0x85});                         // jne start
+            auto start = compiler.emitRel32();
+            compiler.emit({0x48, 0x83, 0xeb, 0x10});             // sub rbx, 16
+            compiler.emit({0xe9});                               // jmp target
+            branchFixups.emplace_back(compiler.emitRel32(), instruction.target);
+            compiler.patchRel32(start, compiler.code.size());
+            compiler.beginFailure("?DO: return stack overflow", ThrowReturnStackOverflow);
+            compiler.emitDo();
+            compiler.endInline();
+        }
+        else if (xt == loopXt) {
+            compiler.beginFailure("LOOP: return stack underflow", ThrowReturnStackUnderflow);
+            compiler.emit({0x49, 0x8b, 0x07});                   // mov rax, [r15]
+            compiler.requireRDepth(2);
+            compiler.endInline();
+            compiler.emit({0x48, 0x8b, 0x08});                   // mov rcx, [rax]
+            compiler.emit({0x48, 0x83, 0xc1, 0x01});             // add rcx, 1
+            compiler.emit({0x48, 0x3b, 0x48, 0xf8});             // cmp rcx, [rax - 8]
+            compiler.emit({0x48, 0x89, 0x08});                   // mov [rax], rcx
+            compiler.emit({0x0f, 0x85});                         // jne target
+            branchFixups.emplace_back(compiler.emitRel32(), instruction.target);
+            compiler.emitUnloop();
+        }
+        else if (xt == plusLoopXt) {
+            compiler.beginFailure("+LOOP: stack underflow", ThrowStackUnderflow);
+            compiler.requireDepth(1);
+            compiler.endInline();
+            compiler.beginFailure("+LOOP: return stack underflow", ThrowReturnStackUnderflow);
+            compiler.emit({0x49, 0x8b, 0x07});                   // mov rax, [r15]
+            compiler.requireRDepth(2);
+            compiler.endInline();
+            compiler.emit({0x48, 0x8b, 0x13});                   // mov rdx, [rbx]
+            compiler.emit({0x48, 0x83, 0xeb, 0x08});             // sub rbx, 8
+            // The loop ends if the index minus the limit, x, and x + n differ
+            // in sign, but x and n don't.
+            compiler.emit({0x48, 0x8b, 0x08});                   // mov rcx, [rax]
+            compiler.emit({0x48, 0x89, 0xce});                   // mov rsi, rcx
+            compiler.emit({0x48, 0x2b, 0x70, 0xf8});             // sub rsi, [rax - 8]
+            compiler.emit({0x48, 0x01, 0xd1});                   // add rcx, rdx
+            compiler.emit({0x48, 0x89, 0x08});                   // mov [rax], rcx
+            compiler.emit({0x48, 0x8d, 0x3c, 0x16});             // lea rdi, [rsi + rdx]
+            compiler.emit({0x48, 0x31, 0xf7});                   // xor rdi, rsi
+            compiler.emit({0x48, 0x31, 0xf2});                   // xor rdx, rsi
+            compiler.emit({0x48, 0x85, 0xd7});                   // test rdi, rdx
+            compiler.emit({0x0f, 0x89});                         // jns target
+            branchFixups.emplace_back(compiler.emitRel32(), instruction.target);
+            compiler.emitUnloop();
+        }
+        else if (xt == litPlusXt || xt == litEqualsXt) {
+            compiler.emitLiteralOperation(xt, instruction.operand);
+        }
+        else if (xt == localFetchXt) {
+            compiler.emitLocalFetch(instruction.operand);
+        }
+        else if (xt == localStoreXt) {
+            compiler.emitLocalStore(instruction.operand);
+        }
+        else if (xt == localsXt) {
+            compiler.emitHelperCall(CELL(localsForNative), instruction.operand);
+        }
+        else if (xt == setDoesXt) {
+            // The DOES> instructions start after the EXIT that follows (does).
+            compiler.emit({0x48, 0xbf}); compiler.emit64(CELL(instruction.address + 2)); // mov rdi, body
+            compiler.emit({0x48, 0xb8}); compiler.emit64(CELL(setDoesBody)); // mov rax, setDoesBody
+            compiler.emit({0xff, 0xd0});                         // call rax
+        }
+        else if (xt == tailCallXt) {
+            auto target = XT(instruction.operand);
+            if (target->does == entry)
+                compiler.emitNativeJump(compiler.base);
+            else if (target->uncheckedNative != nullptr && callsUnchecked(target))
+                compiler.emitUncheckedCall(target, true);
+            else if (target->native != nullptr)
+                compiler.emitNativeJump(target->native->inner);
+            else {
+                // The target is still being compiled, so call it and exit.
+                compiler.emitExecute(target);
+                compiler.emitExit();
+            }
+        }
+        else if (xt->code == doColon && xt->does == entry) {
+            compiler.emitNativeCall(xt, compiler.base);
+        }
+        else if (xt->code == doColon && xt->uncheckedNative != nullptr && callsUnchecked(xt)) {
+            compiler.emitUncheckedCall(xt, false);
+        }
+        else if (xt->code == doColon && xt->native != nullptr) {
+            compiler.emitNativeCall(xt, xt->native->inner);
+        }
+        else if (xt->code == doFused) {
+            for (auto word = xt->parameter; *word != 0; ++word) {
+                if (!compiler.emitPrimitive(XT(*word)))
+                    compiler.emitExecute(XT(*word));
+            }
+        }
+        else if (xt->code == doDefer) {
+            compiler.emitDeferredCall(xt);
+        }
+        else if (!compiler.emitPrimitive(xt)) {
+            compiler.emitExecute(xt);
+        }
+    };
+
+    // The register IR needs the data stack checks to be gone.
+#ifdef CXXFORTH_SKIP_RUNTIME_CHECKS
+    auto useRegisters = true;
+#else
+    auto useRegisters = !checked;
+#endif
+    if (useRegisters) {
+        auto targets = findTargets(entry, instructions);
+        RegisterCompiler registers(compiler, emitInstruction, positions, branchFixups);
+        for (auto& instruction: instructions)
+            registers.compile(instruction, targets.count(instruction.address) != 0);
+        registers.flush();
+    }
+    else {
+        for (auto& instruction: instructions)
+            emitInstruction(instruction);
+    }
+
+    for (auto& fixup: branchFixups)
+        compiler.patchRel32(fixup.first, positions[fixup.second]);
+
+    compiler.finish();
+
+    auto address = storeCode(compiler.code);
+    auto& word = words[entry];
+    word.inner = address;
+    for (auto& position: positions)
+        word.instructions[position.first] = address + position.second;
+    word.body = word.instructions[entry];
+    return &word;
+}
+
+// Generate the routine that doColon() uses to enter native code.
+//
+// It saves the callee-saved registers and loads them, calls a stub that
+// jumps to the address passed as its argument as if it were an inner entry
+// point, and then stores rbx back into dTop.
+void compileNativeEntry() {
+    NativeCompiler compiler(codePointer);
+    compiler.emit({0x53});                                       // push rbx
+    compiler.emit({0x41, 0x54});                                 // push r12
+    compiler.emit({0x41, 0x55});                                 // push r13
+    compiler.emit({0x41, 0x56});                                 // push r14
+    compiler.emit({0x41, 0x57});                                 // push r15
+    compiler.emit({0x49, 0xbc}); compiler.emit64(CELL(&dTop));   // mov r12, &dTop
+    compiler.emit({0x49, 0xbd}); compiler.emit64(CELL(dStack) - CellSize); // mov r13, dStack - 1
+    compiler.emit({0x49, 0xbe}); compiler.emit64(CELL(dStackLimit)); // mov r14, dStackLimit
+    compiler.emit({0x49, 0xbf}); compiler.emit64(CELL(&rTop));   // mov r15, &rTop
+    compiler.emit({0x49, 0x8b, 0x1c, 0x24});                     // mov rbx, [r12]
+    compiler.emit({0xe8});                                       // call stub
+    auto stubCall = compiler.emitRel32();
+    compiler.emit({0x49, 0x89, 0x1c, 0x24});                     // mov [r12], rbx
+    compiler.emit({0x41, 0x5f});                                 // pop r15
+    compiler.emit({0x41, 0x5e});                                 // pop r14
+    compiler.emit({0x41, 0x5d});                                 // pop r13
+    compiler.emit({0x41, 0x5c});                                 // pop r12
+    compiler.emit({0x5b});                                       // pop rbx
+    compiler.emit({0xc3});                                       // ret
+    compiler.patchRel32(stubCall, compiler.code.size());
+    compiler.emit({0x48, 0x83, 0xec, 0x08});                     // sub rsp, 8
+    compiler.emit({0xff, 0xe7});                                 // jmp rdi
+    nativeEntry = reinterpret_cast<NativeEntry>(storeCode(compiler.code));
+}
+
+// Execute native code starting at the specified address.
+void runNative(CAddr address) {
+    if (nativeEntry(address) != 0)
+        std::rethrow_exception(nativeException);
+}
+
+// Return the checked or unchecked translation of a colon definition,
+// translating it if necessary.
+const NativeWord* nativeCode(const Definition* defn, bool checked) {
+    auto& native = checked ? defn->native : defn->uncheckedNative;
+    if (native == nullptr)
+        native = compileNative(defn->does, checked, coversCallees(defn));
+    return native;
+}
+
+bool hasTranslation(const Definition* defn) {
+    return defn->native != nullptr || defn->uncheckedNative != nullptr;
+}
+
+void runTranslation(const Definition* defn, AAddr resume) {
+    runNative(nativeCode(defn, !canRunUnchecked(defn, resume))->instructions.at(resume));
+}
+
+#endif // CXXFORTH_JIT
+
+/****
+
+When the system is reset, all translations must be discarded, because the
+data-space addresses they were keyed on will be reused.
+
+****/
+
+void resetTranslations() {
+#ifdef CXXFORTH_DIRECT_THREADED
+    threadedBodies.clear();
+    uncheckedThreadedBodies.clear();
+#endif
+#ifdef CXXFORTH_TOKEN_THREADED
+    tokenBodies.clear();
+    tokenDefinitions.clear();
+    tokenIndexes.clear();
+#endif
+#ifdef CXXFORTH_JIT
+    nativeWords.clear();
+    uncheckedNativeWords.clear();
+#endif
+#if defined(CXXFORTH_TOKEN_THREADED) || defined(CXXFORTH_JIT)
+    resetCodeSpace();
+#endif
+#ifdef CXXFORTH_JIT
+    compileNativeEntry();
+#endif
+}
+
+#ifdef CXXFORTH_TIERED
+
+// Return true if a definition has been translated.
+bool isTranslated(const Definition& defn) {
+#if defined(CXXFORTH_DIRECT_THREADED)
+    return defn.threaded != nullptr || defn.uncheckedThreaded != nullptr;
+#elif defined(CXXFORTH_TOKEN_THREADED)
+    return defn.tokens != nullptr;
+#else
+    return defn.native != nullptr || defn.uncheckedNative != nullptr;
+#endif
+}
+
+// .TIERS ( -- )
+//
+// Not a standard word.
+//
+// For each colon or DOES> definition that has been executed, displays the
+// number of calls and backward branches that were interpreted, whether it has
+// been translated, and its name.
+void dotTiers() {
+    for (auto& defn: definitions) {
+        if (defn.code != doColon && defn.code != doDoes)
+            continue;
+        auto translated = isTranslated(defn);
+        if (defn.calls == 0 && !translated)
+            continue;
+        cout << SETBASE() << std::setw(10) << defn.calls << " "
+             << (translated ? "translated  " : "interpreted ")
+             << (defn.name.empty() ? ":NONAME" : defn.name) << endl;
+    }
+}
+
+#endif
+
+/****
+
+Dictionary
+----------
+
+The next section contains words that create elements in the `definitions` list,
+look up elements by name, or traverse the list to perform some operation.
+
+****/
+
+// Create a new definition with specified name and code.
+void definePrimitive(const char* name, Code code) {
+    alignDataPointer();
+
+    Definition defn;
+    defn.code = code;
+    defn.parameter = defn.does = AADDR(dataPointer);
+    defn.name = name;
+    definitions.emplace_back(std::move(defn));
+}
+
+// Determine whether two names are equivalent, using case-insensitive matching.
+bool doNamesMatch(CAddr name1, CAddr name2, Cell nameLength) {
+    for (size_t i = 0; i < nameLength; ++i) {
+        if (std::toupper(name1[i]) != std::toupper(name2[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find a definition by name.
+Xt findDefinition(CAddr nameToFind, Cell nameLength) {
+    if (nameLength == 0)
+        return nullptr;
+
+    for (auto i = definitions.rbegin(); i != definitions.rend(); ++i) {
+        auto& defn = *i;
+        if (!defn.isFindable())
+            continue;
+        auto& name = defn.name;
+        if (name.length() == nameLength) {
+            auto nameCAddr = CADDR(const_cast<char*>(name.data()));
+            if (doNamesMatch(nameToFind, nameCAddr, nameLength)) {
+                return &defn;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Find a local of the definition being compiled by name.
+Xt findLocal(CAddr nameToFind, Cell nameLength) {
+    if (!isCompiling)
+        return nullptr;
+    for (auto i = localDefinitions.rbegin(); i != localDefinitions.rend(); ++i) {
+        auto& name = i->name;
+        if (name.length() == nameLength && doNamesMatch(nameToFind, CADDR(const_cast<char*>(name.data())), nameLength))
+            return &*i;
+    }
+    return nullptr;
+}
+
+// Find a definition by name.
+Xt findDefinition(const string& name) {
+    return findDefinition(CADDR(const_cast<char*>(name.data())), static_cast<Cell>(name.length()));
+}
+
+// FIND ( c-addr -- c-addr 0  |  xt 1  |  xt -1 )
+void find() {
+    REQUIRE_DSTACK_DEPTH(1, "FIND");
+    REQUIRE_DSTACK_AVAILABLE(1, "FIND");
+    auto caddr = CADDR(*dTop);
+    auto length = static_cast<Cell>(*caddr);
+    auto name = caddr + 1;
+    auto word = findLocal(name, length);
+    if (word == nullptr)
+        word = findDefinition(name, length);
+    if (word == nullptr) {
+        push(0);
+    }
+    else {
+        *dTop = CELL(word);
+        push(word->isImmediate() ? 1 : Cell(-1));
+    }
+}
+
+// EXECUTE ( i*x xt -- j*x )
+void execute() {
+    REQUIRE_DSTACK_DEPTH(1, "EXECUTE");
+    auto defn = XT(*dTop); pop();
+    defn->execute();
+}
+
+// CATCH ( i*x xt -- j*x 0 | i*x n )
+//
+// See "Exceptions" above.
+void catchException() {
+    REQUIRE_DSTACK_DEPTH(1, "CATCH");
+    REQUIRE_RSTACK_AVAILABLE(1, "CATCH");
+    auto xt = XT(*dTop); pop();
+
+    CatchFrame frame;
+    frame.previous = catchFrame;
+    frame.dDepth = dStackDepth();
+    frame.rTop = rTop;
+    frame.callTop = callTop;
+    frame.localFrame = localFrame;
+    frame.executingWord = Definition::executingWord;
+    frame.nextInstruction = nextInstruction;
+    frame.barriers = unwindBarriers;
+    rpush(CELL(&frame));
+    catchFrame = &frame;
+
+    if (setjmp(frame.jump) == 0) {
+        try {
+            xt->execute();
+            catchFrame = frame.previous;
+            rTop = frame.rTop;
+            push(0);
+            return;
+        }
+        catch (const AbortException& ex) {
+            thrownCode = ex.code;
+        }
+        catch (...) {
+            catchFrame = frame.previous;
+            throw;
+        }
+    }
+
+    catchFrame = frame.previous;
+    rTop = frame.rTop;
+    callTop = frame.callTop;
+    localFrame = frame.localFrame;
+    dTop = dStack + frame.dDepth - 1;
+    Definition::executingWord = frame.executingWord;
+    nextInstruction = frame.nextInstruction;
+    push(static_cast<Cell>(thrownCode));
+}
+
+// THROW ( k*x n -- k*x | i*x n )
+void throwException() {
+    REQUIRE_DSTACK_DEPTH(1, "THROW");
+    auto code = static_cast<SCell>(*dTop); pop();
+    if (code != 0)
+        throwCode(code);
+}
+
+// >BODY ( xt -- a-addr )
+void toBody() {
+    REQUIRE_DSTACK_DEPTH(1, ">BODY");
+    auto xt = XT(*dTop);
+    *dTop = CELL(xt->parameter);
+}
+
+// XT>NAME ( xt -- c-addr u )
+//
+// Not a standard word.
+//
+// Gives the name associated with an XT.
+void xtToName() {
+    REQUIRE_DSTACK_DEPTH(1, "XT>NAME");
+    REQUIRE_DSTACK_AVAILABLE(1, "XT>NAME");
+    auto xt = XT(*dTop);
+    auto& name = xt->name;
+    *dTop = CELL(name.data());
+    push(static_cast<Cell>(name.length()));
+}
+
+// WORDS ( -- )
+void words() {
+    std::for_each(definitions.rbegin(), definitions.rend(), [](auto& defn) {
+        if (defn.isFindable()) cout << defn.name << " ";
+    });
+}
+
+/****
+
+Optimizing Definitions
+----------------------
+
+When `;` completes a colon definition, it calls `optimizeDefinition()` to
+rewrite the definition's instructions so they will run faster.  The
+optimizer decodes the instructions with `decodeBody()`, including any `DOES>`
+part, applies a series of passes to the list of instructions, and then, if
+anything changed, writes the new instructions back into data space.
+
+The passes may replace an instruction with a different one, combine a sequence
+of instructions into one, or expand one into several.  A removed sequence is
+replaced by a _no-op_, an instruction with a null XT that doesn't generate
+anything.  Each instruction keeps the `address` and `end` of the cells it came
+from, so `encodeDefinition()` can work out where everything has moved to:
+
+- Each instruction is written at the next available cell, followed by its
+  operand if it has one.
+- Cells that are not part of any instruction, such as inline string data, are
+  copied unchanged.
+- Branch offsets are recalculated for the new locations of their targets.
+- A literal whose value is an address within the definition, such as the
+  address of a string compiled by `SLITERAL`, is changed to the new address.
+
+Then `HERE` is moved to the end of the new definition.
+
+The main pass is _superinstruction fusion_.  `fuseInstructions()` looks for
+sequences that match one of the patterns in the `fusions` table, and replaces
+each with the superinstruction named in the table.  A sequence can't be fused
+if any instruction but the first is the target of a branch, because then the
+middle of the sequence could be executed on its own.  To add a fusion, define
+a superinstruction, add it to the dictionary, and add an entry to the table.
+(If the superinstruction has an operand, `Instruction` and the alternative
+inner interpreters also need to know about it.)
+
+The patterns are written as the names of words.  Those names are looked up the
+first time they are all defined, and the optimizer remembers those XTs, so
+that if a program later redefines a word such as `OVER`, the optimizer won't
+replace calls to the new definition.
+
+The `.FUSIONS` word displays the number of times each fusion has been applied.
+To build cxxforth without superinstruction fusion, define the macro
+`CXXFORTH_DISABLE_SUPERINSTRUCTIONS` (pass
+`-DCXXFORTH_DISABLE_SUPERINSTRUCTIONS=ON` to `cmake`).
+
+****/
+
+#ifdef CXXFORTH_FUSIONS_FILE
+#define CXXFORTH_FUSION(fn, name, pattern, body) void fn() { body }
+#include CXXFORTH_FUSIONS_FILE
+#undef CXXFORTH_FUSION
+#endif
+
+struct Fusion {
+    string pattern;                 // names of the words to be replaced
+    string replacement;             // name of the superinstruction, or empty to remove them
+    std::vector<Xt> patternXts;
+    Xt replacementXt = nullptr;
+    Cell count = 0;
+};
+
+std::vector<Fusion> fusions = {
+    // pattern          replacement
+    // --------------------------------------
+    {"(lit) +",         "(lit+)"},
+    {"(lit) =",         "(lit=)"},
+    {"dup (zbranch)",   "(dup-zbranch)"},
+    {"0= (zbranch)",    "(nzbranch)"},
+    {"0= (nzbranch)",   "(zbranch)"},
+    {"0= invert (zbranch)", "(zbranch)"},
+    {"= (zbranch)",     "(=branch)"},
+    {"<> (zbranch)",    "(<>branch)"},
+    {"< (zbranch)",     "(<branch)"},
+    {"> (zbranch)",     "(>branch)"},
+    {"over over",       "(over-over)"},
+    {"swap drop",       "(swap-drop)"},
+    {"@ +",             "(@+)"},
+    {">r r>",           ""},
+    {"r> >r",           ""},
+#ifdef CXXFORTH_FUSIONS_FILE
+#define CXXFORTH_FUSION(fn, name, pattern, body) {pattern, name},
+#include CXXFORTH_FUSIONS_FILE
+#undef CXXFORTH_FUSION
+#endif
+};
+
+// Entries after these were added by FUSE.
+const size_t builtInFusionCount = fusions.size();
+
+// Look up the XTs for any fusions whose words have all been defined.
+void resolveFusions() {
+    for (auto& fusion: fusions) {
+        if (!fusion.patternXts.empty())
+            continue;
+
+        std::vector<Xt> xts;
+        std::istringstream names(fusion.pattern);
+        string name;
+        while (names >> name) {
+            auto xt = findDefinition(name);
+            if (xt == nullptr)
+                break;
+            xts.push_back(xt);
+        }
+        if (names >> name)
+            continue;
+
+        Xt replacementXt = nullptr;
+        if (!fusion.replacement.empty()) {
+            replacementXt = findDefinition(fusion.replacement);
+            if (replacementXt == nullptr)
+                continue;
+        }
+
+        fusion.patternXts = std::move(xts);
+        fusion.replacementXt = replacementXt;
+    }
+}
+
+// Forget the fusion XTs and counts, and the fusions added by FUSE, for a reset
+// of the system.
+void resetFusions() {
+    fusions.resize(builtInFusionCount);
+    sequenceCounts.clear();
+    for (auto& fusion: fusions) {
+        fusion.patternXts.clear();
+        fusion.replacementXt = nullptr;
+        fusion.count = 0;
+    }
+}
+
+// Return the addresses of the instructions that may be jumped to.
+std::set<AAddr> findTargets(AAddr entry, const std::vector<Instruction>& instructions) {
+    std::set<AAddr> targets{entry};
+    for (auto& instruction: instructions) {
+        if (instruction.isBranch())
+            targets.insert(instruction.target);
+        if (instruction.xt == setDoesXt)
+            targets.insert(instruction.address + 2);
+    }
+    return targets;
+}
+
+// Replace sequences of instructions that match the fusions table.  Returns true
+// if anything was changed, in which case removing instructions may have created
+// new matches, so the caller should try again.
+bool fuseInstructions(AAddr entry, std::vector<Instruction>& instructions) {
+    auto targets = findTargets(entry, instructions);
+    auto changed = false;
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        for (auto& fusion: fusions) {
+            auto& pattern = fusion.patternXts;
+            if (pattern.empty())
+                continue;
+
+            // Find the instructions that would be replaced, skipping no-ops.
+            std::vector<size_t> matched;
+            for (auto j = i; j < instructions.size() && matched.size() < pattern.size(); ++j) {
+                auto& instruction = instructions[j];
+                if (j > i && !instruction.follows
+                    && (instructions[j - 1].end != instruction.address || targets.count(instruction.address) != 0))
+                    break;
+                if (instruction.xt == nullptr && j > i)
+                    continue;
+                if (instruction.xt != pattern[matched.size()])
+                    break;
+                matched.push_back(j);
+            }
+            if (matched.size() != pattern.size())
+                continue;
+
+            auto& first = instructions[i];
+            auto last = matched.back();
+            Instruction fused{first.address, fusion.replacementXt};
+            fused.end = instructions[last].end;
+            fused.follows = first.follows;
+            for (auto j: matched) {
+                if (instructions[j].hasOperand()) {
+                    fused.operand = instructions[j].operand;
+                    fused.target = instructions[j].target;
+                }
+            }
+            instructions.erase(instructions.begin() + static_cast<ptrdiff_t>(i) + 1,
+                               instructions.begin() + static_cast<ptrdiff_t>(last) + 1);
+            instructions[i] = fused;
+
+            ++fusion.count;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/****
+
+### Constant Folding
+
+A phrase like `4 CELLS +` or `10 3 *` computes the same value every time it is
+executed, so there's no reason to wait until then.  Before fusion,
+`foldConstants()` looks for a primitive listed in the `foldable` table, or a
+`(lit+)` or `(lit=)`, that is preceded by as many `(lit)` instructions as it
+takes inputs.  It
+executes the primitive on those values, and replaces the whole sequence with
+`(lit)` instructions for whatever the primitive leaves on the stack.  So `4
+CELLS +` becomes `(lit) 32 +`, which the fusion pass then turns into `(lit+)
+32`.  The same rules about branch targets apply as for fusion.
+
+The primitives in the table have no effects other than on the data stack.
+Rather than duplicating what each one does, the optimizer just pushes the
+values onto the data stack and calls the primitive.  If the primitive fails,
+for example with a division by zero, the sequence is left alone, so the error
+will happen when the definition is executed, as it would have otherwise.
+
+`['] X EXECUTE` always executes the same word too, so `foldConstants()` also
+replaces `(lit) xt EXECUTE` with a call of `xt`, which the later passes and
+the translators can then treat like any other call.  Words that take inline
+operands or that work on the instruction stream, like `EXIT` and `(does)`,
+are left alone, because they would behave differently if compiled directly.
+
+****/
+
+// Primitives that can be evaluated at compile time, and their numbers of
+// inputs.
+const std::unordered_map<Code, size_t> foldable = {
+    {drop, 1},        {dup, 1},         {swap, 2},        {over, 2},
+    {rot, 3},         {nip, 2},         {tuck, 2},        {twoDrop, 2},
+    {twoDup, 2},      {twoOver, 4},     {twoSwap, 4},     {questionDup, 1},
+    {overOver, 2},    {swapDrop, 2},    {cells, 1},       {plus, 2},
+    {minus, 2},       {star, 2},        {slash, 2},       {slashMod, 2},
+    {onePlus, 1},     {oneMinus, 1},    {twoStar, 1},     {twoSlash, 1},
+    {negate, 1},      {absValue, 1},    {minimum, 2},     {maximum, 2},
+    {bitwiseAnd, 2},  {bitwiseOr, 2},   {bitwiseXor, 2},  {invert, 1},
+    {lshift, 2},      {rshift, 2},      {equals, 2},      {notEquals, 2},
+    {lessThan, 2},    {greaterThan, 2}, {uLessThan, 2},   {zeroLess, 1},
+    {zeroEquals, 1},
+};
+
+// Return the number of inputs taken by an instruction that can be folded, or
+// zero if it can't be.
+size_t foldableInputs(const Instruction& instruction) {
+    if (instruction.xt == nullptr)
+        return 0;
+    if (instruction.xt == litPlusXt || instruction.xt == litEqualsXt)
+        return 1;
+    auto found = foldable.find(instruction.xt->code);
+    return found == foldable.end() ? 0 : found->second;
+}
+
+// Execute a foldable instruction on the given inputs, setting outputs to its
+// results.  Returns false if that can't be done.
+bool evaluateFoldable(const Instruction& instruction, const std::vector<Cell>& inputs, std::vector<Cell>& outputs) {
+    if (instruction.xt == litPlusXt) {
+        outputs = {inputs.back() + instruction.operand};
+        return true;
+    }
+    if (instruction.xt == litEqualsXt) {
+        outputs = {inputs.back() == instruction.operand ? True : False};
+        return true;
+    }
+
+    auto code = instruction.xt->code;
+    if ((code == slash || code == slashMod) && (inputs.back() == 0 || static_cast<SCell>(inputs.back()) == -1))
+        return false;
+    if ((code == lshift || code == rshift) && inputs.back() >= 8 * CellSize)
+        return false;
+    if (dTop + 2 * inputs.size() >= dStackLimit)
+        return false;
+
+    auto saved = dTop;
+    try {
+        for (auto x: inputs)
+            push(x);
+        code();
+    }
+    catch (const AbortException&) {
+        dTop = saved;
+        return false;
+    }
+    outputs.assign(saved + 1, dTop + 1);
+    dTop = saved;
+    return true;
+}
+
+bool isDefinitionAddress(Cell x);
+
+// Return the word that (lit) x EXECUTE executes, if it can be called directly,
+// or nullptr if it can't.
+Xt executedWord(Cell x) {
+    if (!isDefinitionAddress(x))
+        return nullptr;
+    auto xt = XT(x);
+    if (Instruction{nullptr, xt}.hasOperand() || xt == exitXt || xt == setDoesXt || xt == endOfDefinitionXt)
+        return nullptr;
+    return xt;
+}
+
+// Replace foldable primitives that are applied to literals with the literals
+// that they produce, and literal EXECUTEs with calls.  Returns true if anything
+// was changed.
+bool foldConstants(AAddr entry, std::vector<Instruction>& instructions) {
+    auto targets = findTargets(entry, instructions);
+    auto changed = false;
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto& instruction = instructions[i];
+        if (instruction.xt != nullptr && instruction.xt->code == execute && i > 0) {
+            auto& previous = instructions[i - 1];
+            auto adjacent = instruction.follows
+                || (previous.end == instruction.address && targets.count(instruction.address) == 0);
+            auto xt = previous.xt == doLiteralXt && adjacent ? executedWord(previous.operand) : nullptr;
+            if (xt != nullptr) {
+                Instruction call{previous.address, xt};
+                call.end = instruction.end;
+                call.follows = previous.follows;
+                instructions.erase(instructions.begin() + static_cast<ptrdiff_t>(i));
+                instructions[i - 1] = call;
+                --i;
+                changed = true;
+            }
+            continue;
+        }
+        auto inputCount = foldableInputs(instruction);
+        if (inputCount == 0)
+            continue;
+
+        // Look back for the literals, skipping no-ops.
+        std::vector<Cell> inputs;
+        auto first = i;
+        for (auto j = i; j > 0 && inputs.size() < inputCount; --j) {
+            auto& previous = instructions[j - 1];
+            auto& next = instructions[j];
+            if (!next.follows && (previous.end != next.address || targets.count(next.address) != 0))
+                break;
+            if (previous.xt == nullptr)
+                continue;
+            if (previous.xt != doLiteralXt)
+                break;
+            inputs.insert(inputs.begin(), previous.operand);
+            first = j - 1;
+        }
+        std::vector<Cell> outputs;
+        if (inputs.size() != inputCount || !evaluateFoldable(instruction, inputs, outputs))
+            continue;
+
+        auto address = instructions[first].address;
+        auto follows = instructions[first].follows;
+        std::vector<Instruction> literals;
+        for (auto x: outputs) {
+            Instruction literal{address, doLiteralXt};
+            literal.operand = x;
+            literals.push_back(literal);
+        }
+        if (literals.empty())
+            literals.push_back(Instruction{address, nullptr});
+        for (size_t j = 0; j < literals.size(); ++j) {
+            literals[j].end = instruction.end;
+            literals[j].follows = j == 0 ? follows : true;
+        }
+        instructions.erase(instructions.begin() + static_cast<ptrdiff_t>(first),
+                           instructions.begin() + static_cast<ptrdiff_t>(i) + 1);
+        instructions.insert(instructions.begin() + static_cast<ptrdiff_t>(first), literals.begin(), literals.end());
+        i = first + literals.size() - 1;
+        changed = true;
+    }
+
+    return changed;
+}
+
+/****
+
+### Inlining
+
+Many of the words defined in Forth below, such as `TRUE`, `CELL+`, `0>`, and
+`U>`, are only two or three cells long, so calling one of them costs more than
+executing its instructions.  So the second pass, `inlineCalls()`, replaces
+each call to a colon definition whose body is no more than `inlineLimit` cells
+long, and which contains no branches or `DOES>`, with a copy of that body.
+Then the folding and fusion passes run again, so that `TRUE =` can become
+`(lit=) -1`, and `1 CELL+` can become `(lit) 9`.  The called word's body has already been optimized when it was defined,
+so one level of inlining is enough, and a recursive call is never inlined.
+
+Variables, constants, and words made by `CREATE` and `DOES>` are inlined too,
+because pushing a number onto the stack doesn't need a call.  A word whose
+`code` is `doCreate()`, such as a `VARIABLE`, becomes `(lit)` of its data field
+address.  A `DOES>` word becomes `(lit)` of its data field address followed by
+a copy of its `DOES>` instructions, under the same rules as a colon definition.
+And a word whose `code` is `doConstant()` becomes `(lit)` of its value, which
+the folding pass can then work with.  Changing the value of a constant after it
+has been used is an ambiguous condition in the standard, and here the
+definitions that were already compiled keep the old value.  Calls to values and
+deferred words are left alone, because their code fields already do their jobs
+in one step, and `TO` and `IS` can change what they do.
+
+A structure field defined by `+FIELD` becomes `(lit+)` of its offset, or
+nothing at all if the offset is zero.  So a field applied to an address
+computed at run time is a single instruction, and a field applied to a
+constant address, like `buffer HEADER-LENGTH`, folds into a single `(lit)`.
+
+The copied instructions all have the `address` and `end` of the call they
+replace, and each but the first is marked as `follows`, which tells the fusion
+pass that it is adjacent to the one before it and can't be the target of a
+branch.
+
+Inlining doesn't change the meaning of a program, because a Forth definition
+always calls the definition of a word that was current when it was compiled,
+and this implementation's return stack doesn't hold return addresses.  But a
+program that changes a definition's body after it has been compiled can
+prevent it from being inlined by following the definition with the
+non-standard word `NOINLINE`.  `inlineLimit` starts with the value of the macro
+`CXXFORTH_INLINE_LIMIT`, and can be changed with the non-standard
+`INLINE-LIMIT` variable.  Setting it to zero disables inlining.
+
+****/
+
+Cell inlineLimit = CXXFORTH_INLINE_LIMIT;
+
+// INLINE-LIMIT ( -- a-addr )
+//
+// Not a standard word.
+//
+// Variable containing the maximum number of cells in a definition that can be
+// inlined.
+void inlineLimitAddress() {
+    REQUIRE_DSTACK_AVAILABLE(1, "INLINE-LIMIT");
+    push(CELL(&inlineLimit));
+}
+
+// NOINLINE ( -- )
+//
+// Not a standard word.
+//
+// Prevents the most recent definition from being inlined.
+void noInline() { lastDefinition().flags |= Definition::FlagNoInline; }
+
+// If calls to xt can be inlined, set body to the instructions that replace the
+// call, and return true.
+bool findInlineBody(Xt xt, std::vector<Instruction>& body) {
+    auto code = xt->code;
+    if (code == doField && !xt->isNoInline()) {
+        // A field adds its offset, which is nothing at all for the first one.
+        Instruction offset{xt->parameter, litPlusXt};
+        offset.operand = *xt->parameter;
+        if (offset.size() > SIZE_T(inlineLimit))
+            return false;
+        if (offset.operand != 0)
+            body.push_back(offset);
+        return true;
+    }
+    if ((code != doColon && code != doCreate && code != doDoes && code != doConstant) || xt->isNoInline())
+        return false;
+
+    // A CREATEd word or a DOES> word starts by pushing its data field address,
+    // and a constant just pushes its value.
+    size_t size = 0;
+    if (code != doColon) {
+        Instruction literal{xt->parameter, doLiteralXt};
+        literal.operand = code == doConstant ? *xt->parameter : CELL(xt->parameter);
+        size = literal.size();
+        if (size > SIZE_T(inlineLimit))
+            return false;
+        body.push_back(literal);
+        if (code != doDoes)
+            return true;
+    }
+
+    // Without branches, the instructions run straight through to EXIT.
+    for (auto& instruction: decodeBody(xt->does)) {
+        if (instruction.xt == exitXt)
+            break;
+        if (instruction.isBranch() || instruction.xt == setDoesXt || instruction.xt == tailCallXt)
+            return false;
+        size += instruction.size();
+        if (size > SIZE_T(inlineLimit))
+            return false;
+        body.push_back(instruction);
+    }
+    return true;
+}
+
+// Replace calls to short colon definitions with the instructions of those
+// definitions.  Returns true if anything was changed.
+bool inlineCalls(const Definition& defn, std::vector<Instruction>& instructions) {
+    auto changed = false;
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto call = instructions[i];
+        std::vector<Instruction> body;
+        if (call.xt == nullptr || call.xt == &defn || !findInlineBody(call.xt, body))
+            continue;
+
+        if (body.empty())
+            body.push_back(Instruction{call.address, nullptr});
+        for (size_t j = 0; j < body.size(); ++j) {
+            body[j].address = call.address;
+            body[j].end = call.end;
+            body[j].follows = j == 0 ? call.follows : true;
+        }
+        instructions.erase(instructions.begin() + static_cast<ptrdiff_t>(i));
+        instructions.insert(instructions.begin() + static_cast<ptrdiff_t>(i), body.begin(), body.end());
+        i += body.size() - 1;
+        changed = true;
+    }
+
+    return changed;
+}
+
+/****
+
+### Jump Threading
+
+Control structures often compile branches to branches.  For example, in `IF
+... ELSE ... THEN` inside a `BEGIN` loop, the `ELSE` part's `(branch)` goes to
+the `(branch)` that `AGAIN` or `REPEAT` compiled, and a `WHILE` whose loop is
+at the end of an `IF` exits to the `(branch)` compiled by `ELSE`.  So
+`threadJumps()` makes each branch whose target is a `(branch)` go directly to
+that branch's target instead, and replaces a `(branch)` whose target is an
+`EXIT` with an `EXIT`, which lets the tail call pass see a call before it.
+
+A target is only followed to an instruction that starts at that address, so
+a branch into the middle of an inlined call or a superinstruction is never
+changed, and a loop of branches to branches is followed only until it comes
+back around.
+
+****/
+
+// Make branches to (branch) instructions go to their final targets, and
+// replace a (branch) to EXIT with EXIT.  Returns true if anything was changed.
+bool threadJumps(std::vector<Instruction>& instructions) {
+    // The first instruction at each address, which is the one executed by a
+    // branch to that address.
+    std::unordered_map<AAddr, const Instruction*> starting;
+    for (auto& instruction: instructions) {
+        if (!instruction.follows && starting.count(instruction.address) == 0)
+            starting[instruction.address] = &instruction;
+    }
+    auto at = [&](AAddr address) -> const Instruction* {
+        auto found = starting.find(address);
+        return found == starting.end() ? nullptr : found->second;
+    };
+
+    auto changed = false;
+    for (auto& instruction: instructions) {
+        if (instruction.xt == nullptr || !instruction.isBranch())
+            continue;
+
+        auto target = instruction.target;
+        for (size_t steps = 0; steps < instructions.size(); ++steps) {
+            auto next = at(target);
+            if (next == nullptr || next->xt != branchXt || next->target == target)
+                break;
+            target = next->target;
+        }
+        if (target != instruction.target) {
+            instruction.target = target;
+            changed = true;
+        }
+
+        auto destination = at(target);
+        if (instruction.xt == branchXt && destination != nullptr && destination->xt == exitXt) {
+            instruction.xt = exitXt;
+            instruction.operand = 0;
+            instruction.target = nullptr;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/****
+
+### Tail Calls
+
+The last pass, `markTailCalls()`, replaces a call to a colon definition that
+is immediately followed by `EXIT` with `(tail)`, as described in **Tail
+Calls**.  The `EXIT` stays where it is, because it may also be the target of
+a branch.  Only calls to words whose `code` is `doColon` are replaced, because
+other words, including `DOES>` words, have work to do before their
+instructions run.
+
+****/
+
+// Replace calls to colon definitions that are followed by EXIT with tail
+// calls.  Returns true if anything was changed.
+bool markTailCalls(std::vector<Instruction>& instructions) {
+    auto changed = false;
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto& call = instructions[i];
+        if (call.xt == nullptr || call.xt->code != doColon)
+            continue;
+
+        auto j = i + 1;
+        while (j < instructions.size() && instructions[j].xt == nullptr
+               && (instructions[j].follows || instructions[j - 1].end == instructions[j].address))
+            ++j;
+        if (j == instructions.size() || instructions[j].xt != exitXt
+            || !(instructions[j].follows || instructions[j - 1].end == instructions[j].address))
+            continue;
+
+        Instruction tail{call.address, tailCallXt};
+        tail.operand = CELL(call.xt);
+        tail.end = call.end;
+        tail.follows = call.follows;
+        call = tail;
+        changed = true;
+    }
+
+    return changed;
+}
+
+/****
+
+### Stack Effects
+
+Every primitive checks that the data stack holds its inputs and has room for
+its outputs.  But in most definitions, the number of cells on the stack at
+each instruction, relative to the number when the definition was called,
+doesn't depend on anything but the instructions themselves.  If the optimizer
+knows that, then it can work out the most cells that the definition needs
+when it is called, and the most it adds, and one check at entry covers all of
+its instructions.
+
+So after the other passes, `inferStackEffect()` follows every path through
+the instructions, keeping track of the depth relative to the entry depth.  It
+needs to know the stack effect of each word that is called:
+
+- The primitives listed in the `primitiveEffects` table.
+- `(lit)`, the superinstructions, the branches, and the instructions that
+  create and use locals, which it knows about.
+- `CREATE` words, which push one cell, and `DOES>` words, which push one cell
+  and then run their `DOES>` instructions.
+- A colon definition whose own stack effect is known.
+- `PICK` and `ROLL` with an index given by the `(lit)` just before them.
+- `?DUP` followed by `(zbranch)`, because then the duplicated cell is only
+  left on the stack on the path where the branch isn't taken.
+
+If a word isn't one of those, such as `EXECUTE`, or if two paths reach the
+same instruction with different depths, or reach `EXIT` with different
+depths, then the stack effect is unknown.  The same applies to any definition
+that calls it, including a recursive definition.
+
+The stack effect is kept in the definition's `effect` field, and
+`SEE` displays it.  The alternative inner interpreters use it to run
+definitions without their data stack checks, as described in **Tiered
+Execution**.  The `DOES>` instructions of a definition have their own stack
+effects, which are kept in `stackEffects` until `DOES>` is executed.
+
+Only the data stack is verified.  Return-stack and alignment checks are
+always made.
+
+****/
+
+// The numbers of cells taken and left by primitives whose stack effects the
+// verifier knows.
+const std::unordered_map<Code, std::pair<size_t, size_t>> primitiveEffects = {
+    {drop, {1, 0}},        {dup, {1, 2}},         {swap, {2, 2}},        {over, {2, 3}},
+    {rot, {3, 3}},         {nip, {2, 1}},         {tuck, {2, 3}},        {twoDrop, {2, 0}},
+    {twoDup, {2, 4}},      {twoOver, {4, 6}},     {twoSwap, {4, 4}},     {overOver, {2, 4}},
+    {swapDrop, {2, 1}},    {fetchPlus, {2, 1}},   {toR, {1, 0}},         {rFrom, {0, 1}},
+    {rFetch, {0, 1}},      {store, {2, 0}},       {fetch, {1, 1}},       {cstore, {2, 0}},
+    {cfetch, {1, 1}},      {plusStore, {2, 0}},   {cells, {1, 1}},       {plus, {2, 1}},
+    {minus, {2, 1}},       {star, {2, 1}},        {slash, {2, 1}},       {slashMod, {2, 2}},
+    {onePlus, {1, 1}},     {oneMinus, {1, 1}},    {twoStar, {1, 1}},     {twoSlash, {1, 1}},
+    {negate, {1, 1}},      {absValue, {1, 1}},    {minimum, {2, 1}},     {maximum, {2, 1}},
+    {bitwiseAnd, {2, 1}},  {bitwiseOr, {2, 1}},   {bitwiseXor, {2, 1}},  {invert, {1, 1}},
+    {lshift, {2, 1}},      {rshift, {2, 1}},      {equals, {2, 1}},      {notEquals, {2, 1}},
+    {lessThan, {2, 1}},    {greaterThan, {2, 1}}, {uLessThan, {2, 1}},   {zeroLess, {1, 1}},
+    {zeroEquals, {1, 1}},  {doDo, {2, 0}},        {loopIndex, {0, 1}},   {outerLoopIndex, {0, 1}},
+    {unloop, {0, 0}},      {depth, {0, 1}},       {count, {1, 2}},       {align, {0, 0}},
+    {aligned, {1, 1}},     {here, {0, 1}},        {allot, {1, 0}},       {comma, {1, 0}},
+    {cComma, {1, 0}},      {unused, {0, 1}},      {cMove, {3, 0}},       {cMoveUp, {3, 0}},
+    {fill, {3, 0}},        {compare, {4, 1}},     {key, {0, 1}},         {emit, {1, 0}},
+    {spaces, {1, 0}},      {type, {2, 0}},        {cr, {0, 0}},          {dot, {1, 0}},
+    {uDot, {1, 0}},        {dotR, {2, 0}},        {dotS, {0, 0}},        {base, {0, 1}},
+    {state, {0, 1}},       {source, {0, 2}},      {toIn, {0, 1}},        {bl, {0, 1}},
+    {ms, {1, 0}},          {toBody, {1, 1}},      {setDoes, {0, 0}},     {create, {0, 0}},
+    {unlocals, {0, 0}},
+};
+
+// Stack effects of the DOES> parts of definitions, keyed by their entry
+// addresses.
+std::unordered_map<AAddr, StackEffect> stackEffects;
+
+// Return the stack effect of the instructions at entry, if known.
+StackEffect stackEffectAt(AAddr entry) {
+    auto found = stackEffects.find(entry);
+    return found == stackEffects.end() ? StackEffect() : found->second;
+}
+
+// Return the stack effect of executing a word.
+StackEffect wordEffect(Xt xt) {
+    StackEffect effect;
+    if (xt->code == doColon) {
+        effect = xt->effect;
+    }
+    else if (xt->code == doCreate || xt->code == doConstant || xt->code == doValue) {
+        effect.out = effect.peak = 1;
+        effect.known = true;
+    }
+    else if (xt->code == doField) {
+        effect.in = effect.out = 1;
+        effect.known = true;
+    }
+    else if (xt->code == doDoes) {
+        // The DOES> instructions start with the parameter address on top.
+        auto& does = xt->effect;
+        if (does.known) {
+            effect.in = does.in > 0 ? does.in - 1 : 0;
+            effect.out = effect.in + 1 + does.out - does.in;
+            effect.peak = 1 + does.peak;
+            effect.known = true;
+        }
+    }
+    else if (xt->code == doFused) {
+        // Run the words one after another.
+        SCell depth = 0, lowest = 0, highest = 0;
+        for (auto word = xt->parameter; *word != 0; ++word) {
+            auto e = wordEffect(XT(*word));
+            if (!e.known)
+                return StackEffect();
+            lowest = std::min(lowest, depth - static_cast<SCell>(e.in));
+            highest = std::max(highest, depth + static_cast<SCell>(e.peak));
+            depth += static_cast<SCell>(e.out) - static_cast<SCell>(e.in);
+        }
+        effect.in = static_cast<size_t>(-lowest);
+        effect.out = static_cast<size_t>(depth - lowest);
+        effect.peak = static_cast<size_t>(highest);
+        effect.known = true;
+    }
+    else {
+        auto found = primitiveEffects.find(xt->code);
+        if (found != primitiveEffects.end()) {
+            effect.in = found->second.first;
+            effect.out = found->second.second;
+            effect.peak = effect.out > effect.in ? effect.out - effect.in : 0;
+            effect.known = true;
+        }
+    }
+    return effect;
+}
+
+// Work out the stack effect of the instructions starting at entry, and
+// optionally the depth before each instruction, relative to the entry depth.
+StackEffect inferStackEffect(AAddr entry, std::unordered_map<AAddr, SCell>* depthsAt = nullptr) {
+    auto instructions = decodeBody(entry);
+    auto targets = findTargets(entry, instructions);
+
+    std::unordered_map<AAddr, size_t> indexes;
+    for (size_t i = 0; i < instructions.size(); ++i)
+        indexes[instructions[i].address] = i;
+
+    // The depth before each instruction, relative to the entry depth, and
+    // the instructions whose depths are known but which haven't been followed.
+    std::vector<SCell> depths(instructions.size());
+    std::vector<bool> reached(instructions.size());
+    std::vector<size_t> pending;
+
+    SCell lowest = 0;        // lowest depth that an instruction needs
+    SCell highest = 0;       // highest depth reached
+    SCell exitDepth = 0;
+    auto exited = false;
+
+    // Return false if an instruction has already been reached with a
+    // different depth.
+    auto reach = [&](AAddr address, SCell depth) {
+        auto found = indexes.find(address);
+        if (found == indexes.end())
+            return false;
+        auto i = found->second;
+        if (reached[i])
+            return depths[i] == depth;
+        reached[i] = true;
+        depths[i] = depth;
+        pending.push_back(i);
+        return true;
+    };
+
+    // Return the depth after executing a word with the specified effect.
+    auto apply = [&](SCell depth, const StackEffect& effect) {
+        lowest = std::min(lowest, depth - static_cast<SCell>(effect.in));
+        highest = std::max(highest, depth + static_cast<SCell>(effect.peak));
+        return depth - static_cast<SCell>(effect.in) + static_cast<SCell>(effect.out);
+    };
+
+    auto leave = [&](SCell depth) {
+        if (exited)
+            return exitDepth == depth;
+        exited = true;
+        exitDepth = depth;
+        return true;
+    };
+
+    auto effectOf = [](size_t in, size_t out) {
+        StackEffect effect;
+        effect.in = in;
+        effect.out = out;
+        effect.peak = out > in ? out - in : 0;
+        effect.known = true;
+        return effect;
+    };
+
+    if (!reach(entry, 0))
+        return StackEffect();
+
+    while (!pending.empty()) {
+        auto i = pending.back(); pending.pop_back();
+        auto& instruction = instructions[i];
+        auto xt = instruction.xt;
+        auto depth = depths[i];
+
+        // (lit) n just before PICK or ROLL.
+        auto literalIndex = [&](Cell& n) {
+            if (i == 0 || targets.count(instruction.address) != 0)
+                return false;
+            auto& previous = instructions[i - 1];
+            n = previous.operand;
+            return previous.xt == doLiteralXt && previous.end == instruction.address
+                && n < CXXFORTH_DSTACK_COUNT;
+        };
+
+        auto ok = true;
+        Cell n = 0;
+        if (xt == exitXt) {
+            ok = leave(depth);
+        }
+        else if (xt == branchXt) {
+            ok = reach(instruction.target, depth);
+        }
+        else if (instruction.isBranch()) {
+            StackEffect effect;
+            if (xt == zbranchXt || xt == nzbranchXt)
+                effect = effectOf(1, 0);
+            else if (branchComparison(xt) != nullptr)
+                effect = effectOf(2, 0);
+            else if (xt == dupZbranchXt)
+                effect = effectOf(1, 1);
+            else if (xt == qdoXt)
+                effect = effectOf(2, 0);
+            else if (xt == loopXt)
+                effect = effectOf(0, 0);
+            else
+                effect = effectOf(1, 0);
+            depth = apply(depth, effect);
+            ok = reach(instruction.target, depth) && reach(instruction.end, depth);
+        }
+        else if (xt == tailCallXt) {
+            auto effect = wordEffect(XT(instruction.operand));
+            ok = effect.known && leave(apply(depth, effect));
+        }
+        else if (xt == doLiteralXt) {
+            ok = reach(instruction.end, apply(depth, effectOf(0, 1)));
+        }
+        else if (xt == litPlusXt || xt == litEqualsXt) {
+            ok = reach(instruction.end, apply(depth, effectOf(1, 1)));
+        }
+        else if (xt == localFetchXt || xt == localStoreXt || xt == localsXt) {
+            auto effect = xt == localFetchXt ? effectOf(0, 1)
+                : xt == localStoreXt ? effectOf(1, 0)
+                : effectOf(SIZE_T(instruction.operand), 0);
+            ok = reach(instruction.end, apply(depth, effect));
+        }
+        else if (xt->code == pick && literalIndex(n)) {
+            ok = reach(instruction.end, apply(depth, effectOf(n + 2, n + 2)));
+        }
+        else if (xt->code == roll && literalIndex(n)) {
+            ok = reach(instruction.end, apply(depth, effectOf(n + 2, n + 1)));
+        }
+        else if (xt->code == questionDup) {
+            auto next = i + 1 < instructions.size() ? &instructions[i + 1] : nullptr;
+            ok = next != nullptr && next->xt == zbranchXt && next->address == instruction.end
+                && targets.count(next->address) == 0;
+            if (ok) {
+                apply(depth, effectOf(1, 2));
+                ok = reach(next->target, depth - 1) && reach(next->end, depth);
+            }
+        }
+        else {
+            auto effect = wordEffect(xt);
+            ok = effect.known && reach(instruction.end, apply(depth, effect));
+        }
+        if (!ok)
+            return StackEffect();
+    }
+
+    if (depthsAt != nullptr) {
+        for (size_t i = 0; i < instructions.size(); ++i)
+            (*depthsAt)[instructions[i].address] = depths[i];
+    }
+
+    // A definition that never exits may be treated as leaving anything.
+    StackEffect effect;
+    effect.in = static_cast<size_t>(-lowest);
+    effect.out = static_cast<size_t>(exitDepth - lowest);
+    effect.peak = static_cast<size_t>(highest);
+    effect.known = true;
+    return effect;
+}
+
+// Find the depth before the instruction at address, relative to the depth
+// at entry.  Returns false if it isn't known.
+bool stackDepthAt(AAddr entry, AAddr address, SCell& depth) {
+    std::unordered_map<AAddr, SCell> depths;
+    if (!inferStackEffect(entry, &depths).known || depths.count(address) == 0)
+        return false;
+    depth = depths[address];
+    return true;
+}
+
+// Work out the stack effects of a definition and its DOES> parts.
+void inferStackEffects(Definition& defn) {
+    defn.effect = inferStackEffect(defn.does);
+    for (auto& instruction: decodeBody(defn.does, true)) {
+        if (instruction.xt == setDoesXt)
+            stackEffects[instruction.address + 2] = inferStackEffect(instruction.address + 2);
+    }
+}
+
+// Write the instructions of a definition back into data space, as described
+// above.
+void encodeDefinition(AAddr start, const std::vector<Instruction>& instructions) {
+    auto end = AADDR(dataPointer);
+
+    std::vector<Cell> cells;
+    std::unordered_map<AAddr, size_t> moved;
+    std::vector<std::pair<size_t, const Instruction*>> emitted;
+
+    auto next = instructions.begin();
+    for (auto address = start; address < end; ) {
+        if (next != instructions.end() && next->address == address) {
+            // An inlined call expands into several instructions at the same
+            // address, and a superinstruction may also cover the first part
+            // of an inlined call, leaving the rest at the call's address.
+            auto position = cells.size();
+            auto instructionEnd = address;
+            for (; next != instructions.end() && (next->address == address || next->address < instructionEnd); ++next) {
+                instructionEnd = std::max(instructionEnd, next->end);
+                if (next->xt != nullptr) {
+                    emitted.emplace_back(cells.size(), &*next);
+                    cells.push_back(CELL(next->xt));
+                    if (next->hasOperand())
+                        cells.push_back(next->operand);
+                }
+            }
+            for (; address < instructionEnd; ++address)
+                moved[address] = position;
+        }
+        else {
+            moved[address] = cells.size();
+            cells.push_back(*address);
+            ++address;
+        }
+    }
+
+    auto relocate = [&](Cell x) {
+        if (x < CELL(start) || CELL(end) <= x)
+            return x;
+        auto offset = (x - CELL(start)) % CellSize;
+        return CELL(start + moved[AADDR(x - offset)]) + offset;
+    };
+
+    for (auto& e: emitted) {
+        auto position = e.first;
+        auto& instruction = *e.second;
+        if (instruction.isBranch()) {
+            auto offset = static_cast<SCell>(moved[instruction.target]) - static_cast<SCell>(position + 1);
+            cells[position + 1] = static_cast<Cell>(offset * static_cast<SCell>(CellSize));
+        }
+        else if (instruction.hasOperand()) {
+            cells[position + 1] = relocate(instruction.operand);
+        }
+    }
+
+    RUNTIME_ERROR_IF(CADDR(start + cells.size()) >= dataSpaceLimit, ";: data space overflow", ThrowDictionaryOverflow);
+    std::copy(cells.begin(), cells.end(), start);
+    dataPointer = CADDR(start + cells.size());
+}
+
+// Optimize the instructions of the colon definition that has just been
+// completed.
+void optimizeDefinition(Definition& defn) {
+    auto entry = defn.does;
+    auto instructions = decodeBody(entry, true);
+
+    auto simplify = [&]() {
+        auto changed = false;
+        while (foldConstants(entry, instructions))
+            changed = true;
+#ifndef CXXFORTH_DISABLE_SUPERINSTRUCTIONS
+        resolveFusions();
+        while (fuseInstructions(entry, instructions))
+            changed = true;
+#endif
+        return changed;
+    };
+
+    auto changed = simplify();
+    if (inlineCalls(defn, instructions)) {
+        simplify();
+        changed = true;
+    }
+    if (threadJumps(instructions))
+        changed = true;
+    if (markTailCalls(instructions))
+        changed = true;
+
+    if (changed)
+        encodeDefinition(entry, instructions);
+
+    inferStackEffects(defn);
+}
+
+// .FUSIONS ( -- )
+//
+// Not a standard word.
+//
+// Displays the number of times each superinstruction fusion has been applied.
+// Those added by FUSE are marked, because they aren't built in yet.
+void dotFusions() {
+    for (size_t i = 0; i < fusions.size(); ++i) {
+        auto& fusion = fusions[i];
+        cout << SETBASE() << std::setw(10) << fusion.count << " " << fusion.pattern << " -> "
+             << (fusion.replacement.empty() ? "(nothing)" : fusion.replacement)
+             << (i < builtInFusionCount ? "" : "   \\ FUSE") << endl;
+    }
+}
+
 /****
 
-Next I'll define a few "special words".  They are special in that they are used
-to implement features of the inner interpreter, and are not generally used by
-Forth application code.  As a signifier of their special nature, the words'
-names start and end with with parentheses.
+### Dynamic Superinstructions
+
+`FUSE` records a candidate superinstruction.  It adds a fusion to the table
+for any sequence of words that `isFusable()` accepts, such as those printed by
+`.PROFILE`.  Its superinstruction is a new definition whose `code` is
+`doFused()`, and whose parameter field holds the XTs of the words in the
+sequence, followed by a zero.  If those words are all primitives listed in
+`THREADED_PRIMITIVES`, they are followed by the addresses of their C++
+functions and another zero, and the definition's `does` field points at
+those.  `doFused()` then calls the functions one after another, and otherwise
+executes the words one after another.  For example, after `3 FUSE DUP @ +`,
+each `DUP @ +` in later definitions is replaced by `(dup-@-+)`.
+
+The direct-threaded, token-threaded, and native code translators just expand a
+`doFused()` definition back into its words, because they already dispatch
+cheaply, and the native code compiler can expand many of those words inline.
+
+But calling the words one after another like that is no faster than the
+inner interpreter loop.  At best, it saves the interpreter's checks of each
+word's `code`, and in my tests a loop whose hottest sequences had been fused
+this way ran at the same speed as without them.  So `FUSE` doesn't make
+anything faster on its own, and `.FUSIONS` marks the fusions it added.  The
+benefit comes from a superinstruction written in C++, where the compiler can
+combine the primitives into one function.  So `WRITE-FUSIONS` writes the fusions added by `FUSE` into
+a file as C++ code, for those made up only of the primitives listed in
+`THREADED_PRIMITIVES`, whose C++ names are known.  Each is written as a line
+like this:
+
+    CXXFORTH_FUSION(fused_dup_cells, "(dup-cells)", "dup cells", dup(); cells();)
+
+If cxxforth is then built with the macro `CXXFORTH_FUSIONS_FILE` defined as
+that file's name (pass `-DCXXFORTH_FUSIONS_FILE=/path/to/file` to `cmake`),
+the file is included three times, with different definitions of
+`CXXFORTH_FUSION`, to define the functions, add them to the dictionary, and
+add them to the `fusions` table.
+
+So profile-guided optimization works like this:
+
+1. Set `PROFILING`, run a typical workload, and then use `.PROFILE` to see the
+   sequences that are worth fusing.
+2. Execute the best of those `FUSE` commands, use `WRITE-FUSIONS` to write
+   them out, and rebuild cxxforth with `CXXFORTH_FUSIONS_FILE`.
+
+In my tests, a loop whose two hottest three-word sequences were fused this way
+ran about 25% faster.
 
 ****/
 
-// (lit) ( -- x )
+// Superinstruction created by FUSE.
+void doFused() {
+    auto defn = Definition::executingWord;
+    if (defn->does != defn->parameter) {
+        for (auto code = defn->does; *code != 0; ++code)
+            reinterpret_cast<Code>(*code)();
+    }
+    else {
+        for (auto xt = defn->parameter; *xt != 0; ++xt)
+            XT(*xt)->execute();
+    }
+}
+
+const std::unordered_map<Code, const char*>& primitiveFunctionNames();
+
+// FUSE ( u "<spaces>name" ... -- )
 //
 // Not a standard word.
 //
-// This instruction gets the value of the next cell, puts that on the data
-// stack, and then moves the instruction pointer to the next instruction.  It
-// is used by `LITERAL` and other Forth words that need to specify a cell value
-// to put on the stack during execution.
-void doLiteral() {
-    REQUIRE_DSTACK_AVAILABLE(1, "(lit)");
-    push(CELL(*nextInstruction));
-    ++nextInstruction;
+// Parse u names, and create a superinstruction that replaces that sequence of
+// words in definitions compiled after this.  It only runs faster once it has
+// been written by WRITE-FUSIONS and built in with CXXFORTH_FUSIONS_FILE.
+void fuse() {
+    REQUIRE_DSTACK_DEPTH(1, "FUSE");
+    auto n = SIZE_T(*dTop); pop();
+    if (n < 2)
+        throw AbortException("FUSE: need at least two words");
+
+    Fusion fusion;
+    string replacement = "(";
+    for (size_t i = 0; i < n; ++i) {
+        bl(); word(); count();
+        auto length = SIZE_T(*dTop); pop();
+        auto caddr = CHARPTR(*dTop); pop();
+        auto name = string(caddr, length);
+        auto xt = findDefinition(name);
+        if (xt == nullptr)
+            throw AbortException("FUSE: undefined word: " + name);
+        if (!isFusable(xt))
+            throw AbortException("FUSE: cannot fuse " + name);
+        fusion.pattern += (i == 0 ? "" : " ") + name;
+        replacement += (i == 0 ? "" : "-") + xt->name;
+        fusion.patternXts.push_back(xt);
+    }
+    fusion.replacement = replacement + ")";
+
+    alignDataPointer();
+    Definition defn;
+    defn.code = doFused;
+    defn.parameter = defn.does = AADDR(dataPointer);
+    defn.name = fusion.replacement;
+    for (auto xt: fusion.patternXts)
+        data(CELL(xt));
+    data(0);
+
+    // If the words are all primitives, follow them with their functions, so
+    // that doFused() can call those directly.
+    auto& functionNames = primitiveFunctionNames();
+    auto isPrimitive = [&](Xt xt) { return functionNames.count(xt->code) != 0; };
+    if (std::all_of(fusion.patternXts.begin(), fusion.patternXts.end(), isPrimitive)) {
+        defn.does = AADDR(dataPointer);
+        for (auto xt: fusion.patternXts)
+            data(CELL(xt->code));
+        data(0);
+    }
+
+    definitions.emplace_back(std::move(defn));
+
+    fusion.replacementXt = &definitions.back();
+    fusions.push_back(std::move(fusion));
 }
 
-// (branch) ( -- )
+// .PROFILE ( u -- )
 //
 // Not a standard word.
 //
-// Used by branching/looping constructs.  Unconditionally adds an offset to
-// `next`.  The offset is in the cell following the instruction.
-//
-// The offset is in character units, but must be a multiple of the cell size.
-void branch() {
-    auto offset = reinterpret_cast<SCell>(*nextInstruction);
-    nextInstruction += offset / static_cast<SCell>(CellSize);
+// Displays FUSE commands for the u sequences counted while PROFILING was set
+// that would have saved the most trips through the inner interpreter.
+void dotProfile() {
+    REQUIRE_DSTACK_DEPTH(1, ".PROFILE");
+    auto limit = SIZE_T(*dTop); pop();
+
+    std::vector<std::pair<Cell, std::array<Xt, 3>>> ranked;
+    for (auto& sequence: sequenceCounts) {
+        auto length = sequence.first[2] == nullptr ? 2 : 3;
+        ranked.emplace_back(sequence.second * (length - 1), sequence.first);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](auto& a, auto& b) {
+        return a.first > b.first;
+    });
+
+    for (size_t i = 0; i < ranked.size() && i < limit; ++i) {
+        auto& xts = ranked[i].second;
+        cout << (xts[2] == nullptr ? "2 fuse" : "3 fuse");
+        for (auto xt: xts)
+            if (xt != nullptr) cout << " " << xt->name;
+        cout << "   \\ saves " << ranked[i].first << endl;
+    }
 }
 
-// (zbranch) ( flag -- )
+#ifndef CXXFORTH_DISABLE_FILE_ACCESS
+
+// WRITE-FUSIONS ( c-addr u -- )
 //
 // Not a standard word.
 //
-// Used by branching/looping constructinos.  Adds an offset to `next` if the
-// top-of-stack value is zero.  The offset is in the cell following the
-// instruction.  If top-of-stack is not zero, then continue to the next
-// instruction.
-void zbranch() {
-    REQUIRE_DSTACK_DEPTH(1, "(zbranch)");
-    auto flag = *dTop; pop();
-    if (flag == False)
-        branch();
-    else
-        ++nextInstruction;
+// Write the fusions added by FUSE into the named file, as C++ code for
+// CXXFORTH_FUSIONS_FILE.
+void writeFusions() {
+    REQUIRE_DSTACK_DEPTH(2, "WRITE-FUSIONS");
+    auto length = SIZE_T(*dTop); pop();
+    auto caddr = CHARPTR(*dTop); pop();
+
+    auto& functionNames = primitiveFunctionNames();
+
+    std::ofstream file(string(caddr, length));
+    if (!file.is_open())
+        throw AbortException("WRITE-FUSIONS: unable to create file");
+
+    file << "// Superinstructions written by WRITE-FUSIONS, for CXXFORTH_FUSIONS_FILE." << endl;
+    for (auto i = builtInFusionCount; i < fusions.size(); ++i) {
+        auto& fusion = fusions[i];
+        string function = "fused";
+        string body;
+        for (auto xt: fusion.patternXts) {
+            auto name = functionNames.find(xt->code);
+            if (name == functionNames.end()) {
+                function.clear();
+                break;
+            }
+            function += string("_") + name->second;
+            body += string(name->second) + "(); ";
+        }
+        if (function.empty()) {
+            file << "// Can't be written in C++: " << fusion.pattern << endl;
+            continue;
+        }
+        file << "CXXFORTH_FUSION(" << function << ", \"" << fusion.replacement << "\", \""
+             << fusion.pattern << "\", " << body << ")" << endl;
+    }
 }
 
+#endif
+
 /****
 
-Dictionary
-----------
+Translating to C++
+------------------
 
-The next section contains words that create elements in the `definitions` list,
-look up elements by name, or traverse the list to perform some operation.
+Every optimization so far still executes a colon definition one instruction
+at a time, even if the instructions are machine code.  `SAVE-CXX` goes
+further: it writes a file that translates each colon definition into a C++
+function, which calls the primitives directly and uses `goto` for the
+branches.  If cxxforth is rebuilt with the macro `CXXFORTH_COMPILED_FILE`
+defined as that file's name (pass `-DCXXFORTH_COMPILED_FILE=/path/to/file`
+to `cmake`), the file is included here, where the primitives are visible, so
+the C++ compiler can inline the primitives and the translated definitions
+into one another and optimize them together.
+
+The translations can't replace the dictionary, so the program's source is
+still loaded as usual.  Instead, when `;` completes a definition, it looks
+for a translation with the same name and the same _signature_, which lists
+the definition's instructions, the names of the words it calls, and its
+literals.  If it finds one, it sets the definition's `compiled` field, and
+`doColon()` calls that function rather than executing the instructions.  A
+translation can only be used once, and one that calls another translated
+definition directly can only be used if that definition has been given the
+translation that was expected.  Anything that doesn't match, such as a
+definition that has been edited since the file was written, just runs the
+usual way.
+
+Some things do differ from one run to another: the XTs of the words called,
+and addresses in data space.  So a translation's literals that hold XTs or
+data-space addresses, and the XTs of the words it can't call directly, are
+copied from the definition into the translation's `operands` array when it
+is bound.  The signature records the names and offsets instead.
+
+A definition can't be translated if it contains `DOES>`.  Other words are
+called through their XTs, unless they are primitives listed in
+`THREADED_PRIMITIVES`, whose C++ names are known.  A translation calls
+another one with `callCompiled()`, a C++ call that counts against the call
+stack the way the inner interpreter's calls do, and has the same runtime
+checks, so it behaves the same way as the definition it replaces, except that
+a `(tail)` call of another word uses a C++ call, and so takes up a place on
+the call stack.
+
+To build a program that runs without the threading overhead:
+
+1. Load the program, and use `SAVE-CXX` to write the translations.
+2. Rebuild cxxforth with `CXXFORTH_COMPILED_FILE`, and run the program with
+   that.  The kernel's own colon definitions are translated too.
+
+In my tests, a simple counting loop whose body calls another word ran about
+fifty times faster than with the plain inner interpreter, and faster than the
+native code described in **Native Code**, because the C++ compiler could see
+all of it at once.
 
 ****/
 
-// Create a new definition with specified name and code.
-void definePrimitive(const char* name, Code code) {
-    alignDataPointer();
-
-    Definition defn;
-    defn.code = code;
-    defn.parameter = defn.does = AADDR(dataPointer);
-    defn.name = name;
-    definitions.emplace_back(std::move(defn));
+// The C++ functions of the primitives that translations can call directly.
+const std::unordered_map<Code, const char*>& primitiveFunctionNames() {
+    static const std::unordered_map<Code, const char*> names = {
+#define X(fn) {fn, #fn},
+        THREADED_PRIMITIVES(X)
+#undef X
+    };
+    return names;
 }
 
-// Determine whether two names are equivalent, using case-insensitive matching.
-bool doNamesMatch(CAddr name1, CAddr name2, Cell nameLength) {
-    for (size_t i = 0; i < nameLength; ++i) {
-        if (std::toupper(name1[i]) != std::toupper(name2[i])) {
-            return false;
+bool isDefinitionAddress(Cell x) {
+    for (auto& defn: definitions) {
+        if (CELL(&defn) == x)
+            return true;
+    }
+    return false;
+}
+
+// Return the part of a translation's signature for a call of xt.  If the
+// translation needs xt's XT, add it to operands.
+string describeCallForCxx(Xt xt, std::vector<Cell>& operands) {
+    auto& names = primitiveFunctionNames();
+    auto found = names.find(xt->code);
+    if (found != names.end())
+        return xt->name + "=" + found->second;
+    operands.push_back(CELL(xt));
+    return (xt->code == doColon ? ":" : "") + xt->name;
+}
+
+// Return the part of a translation's signature for an instruction.  If the
+// translation needs a cell that may differ between runs, add it to operands.
+string describeForCxx(const Instruction& instruction, std::vector<Cell>& operands) {
+    auto xt = instruction.xt;
+    if (xt == doLiteralXt || xt == litPlusXt || xt == litEqualsXt) {
+        auto value = instruction.operand;
+        if (isDefinitionAddress(value)) {
+            operands.push_back(value);
+            return xt->name + " '" + XT(value)->name;
+        }
+        if (dataSpace <= CADDR(value) && CADDR(value) < dataSpaceLimit) {
+            operands.push_back(value);
+            return xt->name + " @" + std::to_string(CADDR(value) - dataSpace);
         }
+        return xt->name + " " + std::to_string(static_cast<SCell>(value));
     }
-    return true;
+    if (instruction.isBranch())
+        return xt->name + " " + std::to_string(instruction.target - instruction.address);
+    if (xt == localFetchXt || xt == localStoreXt || xt == localsXt)
+        return xt->name + " " + std::to_string(instruction.operand);
+    if (xt == tailCallXt)
+        return xt->name + " " + describeCallForCxx(XT(instruction.operand), operands);
+    if (xt == exitXt)
+        return xt->name;
+    return describeCallForCxx(xt, operands);
+}
+
+// Return the signature of a colon definition's translation, and the operands
+// to be copied into it.
+string signatureForCxx(const Definition& defn, std::vector<Cell>& operands) {
+    string signature;
+    for (auto& instruction: decodeBody(defn.does))
+        signature += (signature.empty() ? "" : " ") + describeForCxx(instruction, operands);
+    return signature;
+}
+
+#ifdef CXXFORTH_COMPILED_FILE
+
+// A translation written by SAVE-CXX.  callees lists the operands that hold
+// XTs of words called directly, and the translations those words must have.
+struct CompiledWord {
+    const char* name;
+    const char* signature;
+    Code code;
+    Cell* operands;
+    std::vector<std::pair<size_t, Code>> callees;
+};
+
+// Call a translation from another one.  Like doColon(), this counts the call
+// against the call stack.
+inline void callCompiled(Code function, const char* name) {
+    pushCall(name);
+    function();
+    popCall();
 }
 
-// Find a definition by name.
-Xt findDefinition(CAddr nameToFind, Cell nameLength) {
-    if (nameLength == 0)
-        return nullptr;
+#include CXXFORTH_COMPILED_FILE
 
-    for (auto i = definitions.rbegin(); i != definitions.rend(); ++i) {
-        auto& defn = *i;
-        if (!defn.isFindable())
+std::set<const CompiledWord*> boundCompiledWords;
+
+// Give a colon definition its translation, if there is one that matches it.
+void bindCompiled(Definition& defn) {
+    static std::unordered_multimap<string, const CompiledWord*> byName;
+    if (byName.empty()) {
+        for (auto& word: compiledWords)
+            byName.emplace(word.name, &word);
+    }
+
+    auto candidates = byName.equal_range(defn.name);
+    if (defn.name.empty() || candidates.first == candidates.second)
+        return;
+
+    std::vector<Cell> operands;
+    auto signature = signatureForCxx(defn, operands);
+    for (auto i = candidates.first; i != candidates.second; ++i) {
+        auto word = i->second;
+        if (boundCompiledWords.count(word) != 0 || signature != word->signature)
             continue;
-        auto& name = defn.name;
-        if (name.length() == nameLength) {
-            auto nameCAddr = CADDR(const_cast<char*>(name.data()));
-            if (doNamesMatch(nameToFind, nameCAddr, nameLength)) {
-                return &defn;
-            }
-        }
+        auto calleesMatch = std::all_of(word->callees.begin(), word->callees.end(), [&](auto& callee) {
+            auto xt = XT(operands[callee.first]);
+            return xt == &defn ? callee.second == word->code : xt->compiled == callee.second;
+        });
+        if (!calleesMatch)
+            continue;
+        std::copy(operands.begin(), operands.end(), word->operands);
+        boundCompiledWords.insert(word);
+        defn.compiled = word->code;
+        return;
     }
-    return nullptr;
 }
 
-// Find a definition by name.
-Xt findDefinition(const string& name) {
-    return findDefinition(CADDR(const_cast<char*>(name.data())), static_cast<Cell>(name.length()));
-}
+#endif // CXXFORTH_COMPILED_FILE
 
-// FIND ( c-addr -- c-addr 0  |  xt 1  |  xt -1 )
-void find() {
-    REQUIRE_DSTACK_DEPTH(1, "FIND");
-    REQUIRE_DSTACK_AVAILABLE(1, "FIND");
-    auto caddr = CADDR(*dTop);
-    auto length = static_cast<Cell>(*caddr);
-    auto name = caddr + 1;
-    auto word = findDefinition(name, length);
-    if (word == nullptr) {
-        push(0);
+#ifndef CXXFORTH_DISABLE_FILE_ACCESS
+
+// Return a C++ string literal.  Question marks are escaped so that they can't
+// form trigraphs.
+string cxxStringLiteral(const string& s) {
+    string literal = "\"";
+    for (auto c: s) {
+        if (c == '"' || c == '\\' || c == '?')
+            literal += '\\';
+        literal += c;
     }
-    else {
-        *dTop = CELL(word);
-        push(word->isImmediate() ? 1 : Cell(-1));
+    return literal + "\"";
+}
+
+string cxxCellLiteral(Cell value) {
+    auto n = static_cast<SCell>(value);
+    if (n < 0 && value == (static_cast<Cell>(1) << (8 * CellSize - 1)))
+        return "static_cast<Cell>(" + std::to_string(n + 1) + " - 1)";
+    return "static_cast<Cell>(" + std::to_string(n) + ")";
+}
+
+// Write the translation of a colon definition as a C++ function named
+// function, and add its entry for the compiledWords table to table.
+// functions holds the names of all the functions being written.
+void writeCxxFunction(std::ostream& file, std::ostream& table, const Definition& defn,
+                      const string& function, const std::map<const Definition*, string>& functions) {
+    auto entry = defn.does;
+    auto instructions = decodeBody(entry);
+
+    std::set<AAddr> labels;
+    for (auto& instruction: instructions) {
+        if (instruction.isBranch())
+            labels.insert(instruction.target);
+        else if (instruction.xt == tailCallXt && XT(instruction.operand) == &defn)
+            labels.insert(entry);
     }
-}
 
-// EXECUTE ( i*x xt -- j*x )
-void execute() {
-    REQUIRE_DSTACK_DEPTH(1, "EXECUTE");
-    auto defn = XT(*dTop); pop();
-    defn->execute();
-}
+    std::ostringstream body;
+    std::vector<Cell> operands;
+    std::vector<std::pair<size_t, string>> callees;
+    string signature;
+    for (auto& instruction: instructions) {
+        if (labels.count(instruction.address) != 0)
+            body << "l" << (instruction.address - entry) << ":\n";
+
+        auto index = operands.size();
+        signature += (signature.empty() ? "" : " ") + describeForCxx(instruction, operands);
+        auto operand = "operands[" + std::to_string(index) + "]";
+        auto hasOperand = operands.size() > index;
+        auto label = "l" + std::to_string(instruction.target - entry);
+
+        // Return the code for a call of xt, which may be a direct call of its
+        // translation.
+        auto call = [&](Xt xt) -> string {
+            auto& names = primitiveFunctionNames();
+            auto name = names.find(xt->code);
+            if (name != names.end())
+                return string(name->second) + "()";
+            auto translated = functions.find(xt);
+            if (translated != functions.end()) {
+                callees.emplace_back(index, translated->second);
+                return "callCompiled(" + translated->second + ", " + cxxStringLiteral(xt->name) + ")";
+            }
+            return "XT(" + operand + ")->execute()";
+        };
+
+        auto xt = instruction.xt;
+        auto value = hasOperand ? operand : cxxCellLiteral(instruction.operand);
+        body << "    ";
+        if (xt == doLiteralXt)
+            body << "REQUIRE_DSTACK_AVAILABLE(1, \"(lit)\"); push(" << value << ");";
+        else if (xt == litPlusXt)
+            body << "REQUIRE_DSTACK_DEPTH(1, \"+\"); *dTop += " << value << ";";
+        else if (xt == litEqualsXt)
+            body << "REQUIRE_DSTACK_DEPTH(1, \"=\"); *dTop = *dTop == " << value << " ? True : False;";
+        else if (xt == localFetchXt)
+            body << "REQUIRE_DSTACK_AVAILABLE(1, \"(local@)\"); push(localFrame[" << value << "]);";
+        else if (xt == localStoreXt)
+            body << "REQUIRE_DSTACK_DEPTH(1, \"(local!)\"); localFrame[" << value << "] = *dTop; pop();";
+        else if (xt == localsXt)
+            body << "enterLocals(" << value << ");";
+        else if (xt == branchXt)
+            body << "goto " << label << ";";
+        else if (xt == zbranchXt)
+            body << "REQUIRE_DSTACK_DEPTH(1, \"(zbranch)\"); if (*dTop-- == False) goto " << label << ";";
+        else if (xt == dupZbranchXt)
+            body << "REQUIRE_DSTACK_DEPTH(1, \"DUP\"); if (*dTop == False) goto " << label << ";";
+        else if (branchComparison(xt) != nullptr)
+            body << call(branchComparison(xt)) << "; if (*dTop-- == False) goto " << label << ";";
+        else if (xt == qdoXt)
+            body << "REQUIRE_DSTACK_DEPTH(2, \"?DO\"); if (*dTop == *(dTop - 1)) { dTop -= 2; goto "
+                 << label << "; } doDo();";
+        else if (xt == loopXt)
+            body << "REQUIRE_RSTACK_DEPTH(2, \"LOOP\"); if (++*rTop != *(rTop - 1)) goto "
+                 << label << "; rTop -= 2;";
+        else if (xt == plusLoopXt)
+            body << "REQUIRE_DSTACK_DEPTH(1, \"+LOOP\"); REQUIRE_RSTACK_DEPTH(2, \"+LOOP\");\n"
+                 << "    if (!loopCrossesLimit(*rTop, *(rTop - 1), *dTop)) { *rTop += *dTop--; goto "
+                 << label << "; } --dTop; rTop -= 2;";
+        else if (xt == exitXt)
+            body << "return;";
+        else if (xt == tailCallXt && XT(instruction.operand) == &defn)
+            body << "goto l0;";
+        else if (xt == tailCallXt)
+            body << call(XT(instruction.operand)) << "; return;";
+        else
+            body << call(xt) << ";";
+        body << "\n";
+    }
 
-// >BODY ( xt -- a-addr )
-void toBody() {
-    REQUIRE_DSTACK_DEPTH(1, ">BODY");
-    auto xt = XT(*dTop);
-    *dTop = CELL(xt->parameter);
+    file << "\n// " << cxxStringLiteral(defn.name) << "\n";
+    file << "Cell " << function << "Operands[" << std::max(operands.size(), size_t(1)) << "];\n";
+    file << "void " << function << "() {\n";
+    if (body.str().find("operands[") != string::npos)
+        file << "    auto operands = " << function << "Operands;\n";
+    file << body.str() << "}\n";
+
+    table << "    {" << cxxStringLiteral(defn.name) << ",\n     " << cxxStringLiteral(signature)
+          << ",\n     " << function << ", " << function << "Operands, {";
+    for (size_t i = 0; i < callees.size(); ++i)
+        table << (i == 0 ? "" : ", ") << "{" << callees[i].first << ", " << callees[i].second << "}";
+    table << "}},\n";
+}
+
+// Return true if SAVE-CXX can translate a definition.
+bool canWriteCxx(const Definition& defn) {
+    if (defn.code != doColon || !defn.isFindable())
+        return false;
+    auto instructions = decodeBody(defn.does);
+    return std::none_of(instructions.begin(), instructions.end(), [](auto& instruction) {
+        return instruction.xt == setDoesXt;
+    });
 }
 
-// XT>NAME ( xt -- c-addr u )
+// SAVE-CXX ( c-addr u -- )
 //
 // Not a standard word.
 //
-// Gives the name associated with an XT.
-void xtToName() {
-    REQUIRE_DSTACK_DEPTH(1, "XT>NAME");
-    REQUIRE_DSTACK_AVAILABLE(1, "XT>NAME");
-    auto xt = XT(*dTop);
-    auto& name = xt->name;
-    *dTop = CELL(name.data());
-    push(static_cast<Cell>(name.length()));
-}
+// Write C++ translations of the colon definitions into the named file, for
+// CXXFORTH_COMPILED_FILE.
+void saveCxx() {
+    REQUIRE_DSTACK_DEPTH(2, "SAVE-CXX");
+    auto length = SIZE_T(*dTop); pop();
+    auto caddr = CHARPTR(*dTop); pop();
 
-// WORDS ( -- )
-void words() {
-    std::for_each(definitions.rbegin(), definitions.rend(), [](auto& defn) {
-        if (defn.isFindable()) cout << defn.name << " ";
-    });
+    std::ofstream file(string(caddr, length));
+    if (!file.is_open())
+        throw AbortException("SAVE-CXX: unable to create file");
+
+    std::map<const Definition*, string> functions;
+    size_t index = 0;
+    for (auto& defn: definitions) {
+        if (canWriteCxx(defn))
+            functions[&defn] = "compiled" + std::to_string(index);
+        ++index;
+    }
+
+    file << "// Colon definitions translated by SAVE-CXX, for CXXFORTH_COMPILED_FILE." << endl;
+    file << endl;
+    for (auto& function: functions)
+        file << "void " << function.second << "();" << endl;
+
+    std::ostringstream table;
+    for (auto& defn: definitions) {
+        auto function = functions.find(&defn);
+        if (function != functions.end())
+            writeCxxFunction(file, table, defn, function->second, functions);
+    }
+
+    file << endl << "const CompiledWord compiledWords[] = {" << endl;
+    file << table.str() << "};" << endl;
 }
 
+#endif
+
 /****
 
 SEE
@@ -1928,7 +8849,10 @@ exactly equal to the original source text.  For example, for this definition:
 
 `SEE add-1-and-2` gives this output:
 
-    : add-1-and-2 (lit) 1 (lit) 2 + . EXIT ;
+    : add-1-and-2 (lit) 3 . EXIT ; ( 0 -- 0 )
+
+(The `(lit) 3` replaced `(lit) 1 (lit) 2 +`, and the comment after the `;` is
+the stack effect of the instructions; see **Optimizing Definitions**.)
 
 It gets even messier when decompiling words that contain branches and string
 literals, but it works well as a debugging tool when trying to determine why a
@@ -1973,13 +8897,23 @@ void see() {
     bl(); word(); find();
 
     auto found = *dTop; pop();
-    if (!found) throw AbortException("SEE: undefined word");
+    if (!found) throw AbortException("SEE: undefined word", ThrowUndefinedWord);
 
     auto defn = XT(*dTop); pop();
     if (defn->code == doColon) {
         cout << ": " << defn->name;
         seeDoes(defn->does);
     }
+    else if (defn->code == doConstant || defn->code == doValue) {
+        cout << SETBASE() << *defn->parameter
+             << (defn->code == doConstant ? " CONSTANT " : " VALUE ") << defn->name;
+    }
+    else if (defn->code == doDefer) {
+        cout << "DEFER " << defn->name << " ( " << XT(*defn->parameter)->name << " )";
+    }
+    else if (defn->code == doField) {
+        cout << SETBASE() << *defn->parameter << " FIELD " << defn->name;
+    }
     else if (defn->code == doCreate || defn->code == doDoes) {
         cout << "CREATE " << defn->name << " ( " << CELL(defn->parameter) << " )";
         if (defn->code == doDoes) {
@@ -1990,7 +8924,10 @@ void see() {
     else {
         cout << ": " << defn->name << " <primitive " << SETBASE() << CELL(defn->code) << "> ;";
     }
+    if (defn->effect.known)
+        cout << " ( " << SETBASE() << defn->effect.in << " -- " << defn->effect.out << " )";
     if (defn->isImmediate()) cout << " immediate";
+    if (defn->isUnchecked()) cout << " unchecked";
 }
 
 /****
@@ -2110,7 +9047,10 @@ void interpret() {
 
         if (found) {
             auto xt = XT(*dTop); pop();
-            if (isCompiling && !xt->isImmediate()) {
+            if (isCompiling && xt == exitXt) {
+                compileExit();
+            }
+            else if (isCompiling && !xt->isImmediate()) {
                 data(CELL(xt));
             }
             else {
@@ -2143,7 +9083,7 @@ void interpret() {
                     }
                 }
                 else {
-                    throw AbortException(string("unrecognized word: ") + string(caddr, length));
+                    throw AbortException(string("unrecognized word: ") + string(caddr, length), ThrowUndefinedWord);
                 }
             }
             else {
@@ -2168,12 +9108,21 @@ void evaluate() {
     auto length = static_cast<size_t>(*dTop); pop();
     auto caddr = CHARPTR(*dTop); pop();
 
+    UnwindBarrier barrier;
     auto savedInput = std::move(sourceBuffer);
     auto savedOffset = sourceOffset;
 
     sourceBuffer = string(caddr, length);
     sourceOffset = 0;
-    interpret();
+    try {
+        interpret();
+    }
+    catch (const AbortException&) {
+        // Restore the input source for a CATCH, as THROW requires.
+        sourceBuffer = std::move(savedInput);
+        sourceOffset = savedOffset;
+        throw;
+    }
 
     sourceBuffer = std::move(savedInput);
     sourceOffset = savedOffset;
@@ -2181,12 +9130,102 @@ void evaluate() {
 
 /****
 
+Guard Page Faults
+-----------------
+
+When cxxforth is built with `CXXFORTH_GUARD_PAGES`, an overflow shows up as a
+`SIGSEGV` signal (or `SIGBUS` on some platforms) for an address in one of the
+guard pages.  A C++ exception can't be thrown from a signal handler, so
+`guardPageHandler()` uses `siglongjmp()` to return to a recovery point set by
+`sigsetjmp()`, which then throws an `AbortException` with the standard throw
+code for the array.  `QUIT` sets a recovery point before interpreting each line,
+and `cxxforth_main()` sets one for the files named on the command line.  If
+there is a `CATCH` that `THROW` could jump to directly, the handler jumps there
+instead.  (The handler is installed with `SA_NODEFER`, so that the signal
+isn't left blocked after an ordinary `longjmp()`.)  Otherwise, because the
+handler can't throw a C++ exception, the fault goes straight to `QUIT` even if
+there is a `CATCH` outside the `EVALUATE` or `INCLUDE-FILE` that is in the way.
+
+The jump skips the rest of whatever was running, including any destructors, so
+a fault may leak some memory, but it leaves the Forth system in the same state
+as an `ABORT` would.  A fault anywhere else is not ours, so the handler
+restores the previous action for the signal and returns, and the faulting
+instruction faults again.  (An application that incorporates `cxxforth.cpp`
+and doesn't call `cxxforth_main()` gets no handler at all.)
+
+****/
+
+#ifdef CXXFORTH_GUARD_PAGES
+
+sigjmp_buf guardPageRecovery;
+SCell guardPageCode = 0;
+struct sigaction previousSegvAction;
+struct sigaction previousBusAction;
+
+// Return the throw code for a fault at addr, or zero if addr isn't in a guard
+// page.
+SCell guardPageFault(CAddr addr) {
+    struct Guard { const GuardedArray& array; SCell underflow; SCell overflow; };
+    static const Guard guards[] = {
+        { dStackArray,    ThrowStackUnderflow,       ThrowStackOverflow },
+        { rStackArray,    ThrowReturnStackUnderflow, ThrowReturnStackOverflow },
+        { dataSpaceArray, ThrowInvalidAddress,       ThrowDictionaryOverflow },
+    };
+    for (auto& guard: guards) {
+        if (guard.array.base <= addr && addr < guard.array.start)
+            return guard.underflow;
+        if (guard.array.limit <= addr && addr < guard.array.end)
+            return guard.overflow;
+    }
+    return 0;
+}
+
+void guardPageHandler(int sig, siginfo_t* info, void*) {
+    auto code = guardPageFault(CADDR(info->si_addr));
+    if (code == 0) {
+        sigaction(sig, sig == SIGSEGV ? &previousSegvAction : &previousBusAction, nullptr);
+        return;
+    }
+    if (canJumpToCatch())
+        jumpToCatch(code);
+    guardPageCode = code;
+    siglongjmp(guardPageRecovery, 1);
+}
+
+void installGuardPageHandler() {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = guardPageHandler;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &previousSegvAction);
+    sigaction(SIGBUS, &action, &previousBusAction);
+}
+
+// Set the recovery point for guard page faults.  This has to be a macro, because
+// the function that calls sigsetjmp() must still be running when siglongjmp()
+// is called.
+#define SET_GUARD_PAGE_RECOVERY() \
+    do { \
+        if (sigsetjmp(guardPageRecovery, 1) != 0) \
+            throw AbortException(throwMessage(guardPageCode), guardPageCode); \
+    } while (0)
+
+#else
+
+#define SET_GUARD_PAGE_RECOVERY() do { } while (0)
+
+#endif // CXXFORTH_GUARD_PAGES
+
+/****
+
 `QUIT` is the top-level outer interpreter loop. It calls `REFILL` to read a
 line, `INTERPRET` to parse and execute that line, then `PROMPT` and repeat
 until there is no more input.
 
 There is an exception handler for `AbortException` that prints an error
-message, resets the stacks, and continues.
+message, resets the stacks, and continues.  A guard page fault ends up there
+too.
 
 If end-of-input occurs, then it exits the loop and calls `CR` and `BYE`.
 
@@ -2216,9 +9255,11 @@ void quit() {
 
     resetRStack();
     isCompiling = false;
+    auto barriers = unwindBarriers;
 
     for (;;) {
         try {
+            SET_GUARD_PAGE_RECOVERY();
             refill();
             auto refilled = *dTop; pop();
             if (!refilled) // end-of-input
@@ -2234,6 +9275,8 @@ void quit() {
             resetDStack();
             resetRStack();
             isCompiling = false;
+            catchFrame = nullptr;
+            unwindBarriers = barriers;
         }
 
         prompt();
@@ -2340,7 +9383,7 @@ void openFile() {
 void readFile() {
     REQUIRE_DSTACK_DEPTH(3, "READ-FILE");
     auto f = FILEID(*dTop); pop();
-    if (f == nullptr) throw AbortException("READ-FILE: not a valid file ID");
+    if (f == nullptr) throw AbortException("READ-FILE: not a valid file ID", ThrowFileIO);
     auto length = SIZE_T(*dTop);
     auto caddr = CHARPTR(*(dTop - 1));
     f->read(caddr, static_cast<std::streamsize>(length));
@@ -2352,7 +9395,7 @@ void readFile() {
 void readLine() {
     REQUIRE_DSTACK_DEPTH(3, "READ-FILE");
     auto f = FILEID(*dTop);
-    if (f == nullptr) throw AbortException("READ-FILE: not a valid file ID");
+    if (f == nullptr) throw AbortException("READ-FILE: not a valid file ID", ThrowFileIO);
     if (f->eof()) {
         *dTop = 0;
         *(dTop - 1) = False;
@@ -2390,7 +9433,7 @@ void readChar() {
     REQUIRE_DSTACK_DEPTH(1, "READ-CHAR");
     REQUIRE_DSTACK_AVAILABLE(1, "READ-CHAR");
     auto f = FILEID(*dTop);
-    if (f == nullptr) throw AbortException("READ-CHAR: not a valid file ID");
+    if (f == nullptr) throw AbortException("READ-CHAR: not a valid file ID", ThrowFileIO);
     auto ch = static_cast<unsigned char>(f->get());
     *dTop = static_cast<Cell>(ch);
     if (f->bad()) push(static_cast<Cell>(-1)); else push(0);
@@ -2400,7 +9443,7 @@ void readChar() {
 void writeFile() {
     REQUIRE_DSTACK_DEPTH(3, "WRITE-FILE");
     auto f = FILEID(*dTop); pop();
-    if (f == nullptr) throw AbortException("WRITE-FILE: not a valid file ID");
+    if (f == nullptr) throw AbortException("WRITE-FILE: not a valid file ID", ThrowFileIO);
     auto length = SIZE_T(*dTop); pop();
     auto caddr = CHARPTR(*dTop);
     f->write(caddr, static_cast<std::streamsize>(length));
@@ -2411,7 +9454,7 @@ void writeFile() {
 void writeLine() {
     REQUIRE_DSTACK_DEPTH(3, "WRITE-LINE");
     auto f = FILEID(*dTop); pop();
-    if (f == nullptr) throw AbortException("WRITE-FILE: not a valid file ID");
+    if (f == nullptr) throw AbortException("WRITE-FILE: not a valid file ID", ThrowFileIO);
     auto length = SIZE_T(*dTop); pop();
     auto caddr = CHARPTR(*dTop);
     f->write(caddr, static_cast<std::streamsize>(length));
@@ -2427,7 +9470,7 @@ void writeLine() {
 void writeChar() {
     REQUIRE_DSTACK_DEPTH(2, "WRITE-CHAR");
     auto f = FILEID(*dTop); pop();
-    if (f == nullptr) throw AbortException("WRITE-CHAR: not a valid file ID");
+    if (f == nullptr) throw AbortException("WRITE-CHAR: not a valid file ID", ThrowFileIO);
     auto ch = static_cast<char>(*dTop);
     f->put(ch);
     *dTop = f->bad() ? Cell(-1) : 0;
@@ -2437,7 +9480,7 @@ void writeChar() {
 void flushFile() {
     REQUIRE_DSTACK_DEPTH(1, "FLUSH-FILE");
     auto f = FILEID(*dTop);
-    if (f == nullptr) throw AbortException("FLUSH-FILE: not a valid file ID");
+    if (f == nullptr) throw AbortException("FLUSH-FILE: not a valid file ID", ThrowFileIO);
     f->flush();
     *dTop = f->bad() ? Cell(-1) : 0;
 }
@@ -2446,7 +9489,7 @@ void flushFile() {
 void closeFile() {
     REQUIRE_DSTACK_DEPTH(1, "CLOSE-FILE");
     auto f = FILEID(*dTop);
-    if (f == nullptr) throw AbortException("CLOSE-FILE: not a valid file ID");
+    if (f == nullptr) throw AbortException("CLOSE-FILE: not a valid file ID", ThrowFileIO);
     f->close();
     delete f;
     *dTop = 0;
@@ -2485,8 +9528,9 @@ void includeFile() {
     REQUIRE_DSTACK_DEPTH(1, "INCLUDE-FILE");
 
     auto f = FILEID(*dTop); pop();
-    if (f == nullptr) throw AbortException("INCLUDE-FILE: invalid file ID");
+    if (f == nullptr) throw AbortException("INCLUDE-FILE: invalid file ID", ThrowFileIO);
 
+    UnwindBarrier barrier;
     string line;
     while (std::getline(*f, line)) {
         push(CELL(line.data()));
@@ -2573,6 +9617,7 @@ void definePrimitives() {
         {";",               semicolon},
         {"does>",           does},
         {"immediate",       immediate},
+        {"{:",              beginLocals},
     };
     for (auto& w: immediateCodeWords) {
         definePrimitive(w.name, w.code);
@@ -2589,15 +9634,39 @@ void definePrimitives() {
         {"#args",           argCount},
         {"$?",              lastSystemResult},
         {"(;)",             endOfDefinition},
+        {"(+loop)",         plusLoop},
+        {"(<branch)",       lessBranch},
+        {"(<>branch)",      notEqualsBranch},
+        {"(=branch)",       equalsBranch},
+        {"(>branch)",       greaterBranch},
+        {"(?do)",           qdo},
         {"(branch)",        branch},
+        {"(do)",            doDo},
+        {"(@+)",            fetchPlus},
         {"(does)",          setDoes},
+        {"(dup-zbranch)",   dupZbranch},
         {"(lit)",           doLiteral},
+        {"(lit+)",          litPlus},
+        {"(lit=)",          litEquals},
+        {"(local!)",        localStore},
+        {"(local@)",        localFetch},
+        {"(locals)",        locals},
+        {"(loop)",          loop},
+        {"(nzbranch)",      nzbranch},
+        {"(over-over)",     overOver},
+        {"(swap-drop)",     swapDrop},
+        {"(tail)",          tailCall},
+        {"(to-local)",      toLocal},
+        {"(unlocals)",      unlocals},
         {"(zbranch)",       zbranch},
         {"*",               star},
         {"+",               plus},
+        {"+field",          plusField},
         {"-",               minus},
         {".",               dot},
         {".r",              dotR},
+        {".fusions",        dotFusions},
+        {".profile",        dotProfile},
         {".rs",             dotRS},
         {".s",              dotS},
         {"/",               slash},
@@ -2624,15 +9693,18 @@ void definePrimitives() {
         {"base",            base},
         {"bl",              bl},
         {"bye",             bye},
+        {"catch",           catchException},
         {"c!",              cstore},
         {"c@",              cfetch},
         {"cells",           cells},
         {"cmove",           cMove},
         {"cmove>",          cMoveUp},
         {"compare",         compare},
+        {"constant",        constant},
         {"count",           count},
         {"cr",              cr},
         {"create",          create},
+        {"defer",           defer},
         {"depth",           depth},
         {"drop",            drop},
         {"dup",             dup},
@@ -2641,18 +9713,24 @@ void definePrimitives() {
         {"execute",         execute},
         {"exit",            exit},
         {"fill",            fill},
+        {"fuse",            fuse},
         {"find",            find},
         {"free",            memFree},
         {"here",            here},
         {"hidden",          hidden},
+        {"i",               loopIndex},
+        {"inline-limit",    inlineLimitAddress},
         {"interpret",       interpret},
+        {"j",               outerLoopIndex},
         {"key",             key},
         {"latest",          latest},
         {"lshift",          lshift},
         {"ms",              ms},
+        {"noinline",        noInline},
         {"or",              bitwiseOr},
         {"parse",           parse},
         {"pick",            pick},
+        {"profiling",       profilingAddress},
         {"prompt",          prompt},
         {"quit",            quit},
         {"r>",              rFrom},
@@ -2666,16 +9744,55 @@ void definePrimitives() {
         {"state",           state},
         {"swap",            swap},
         {"system",          system},
+        {"throw",           throwException},
         {"time&date",       timeAndDate},
         {"type",            type},
         {"u.",              uDot},
         {"u<",              uLessThan},
+        {"unchecked",       unchecked},
+        {"unloop",          unloop},
         {"unused",          unused},
         {"utctime&date",    utcTimeAndDate},
+        {"value",           value},
         {"word",            word},
         {"words",           words},
         {"xor",             bitwiseXor},
         {"xt>name",         xtToName},
+#if defined(CXXFORTH_TOKEN_THREADED) || defined(CXXFORTH_JIT)
+        {"unused-code",     unusedCode},
+#endif
+#ifndef CXXFORTH_FORTH_CORE_WORDS
+        {",",               comma},
+        {"0<",              zeroLess},
+        {"0=",              zeroEquals},
+        {"1+",              onePlus},
+        {"1-",              oneMinus},
+        {"2*",              twoStar},
+        {"2/",              twoSlash},
+        {"2drop",           twoDrop},
+        {"2dup",            twoDup},
+        {"2over",           twoOver},
+        {"2swap",           twoSwap},
+        {"+!",              plusStore},
+        {"<>",              notEquals},
+        {">",               greaterThan},
+        {"?dup",            questionDup},
+        {"abs",             absValue},
+        {"c,",              cComma},
+        {"invert",          invert},
+        {"max",             maximum},
+        {"min",             minimum},
+        {"negate",          negate},
+        {"nip",             nip},
+        {"over",            over},
+        {"rot",             rot},
+        {"spaces",          spaces},
+        {"tuck",            tuck},
+#endif
+#ifdef CXXFORTH_TIERED
+        {".tiers",          dotTiers},
+        {"tier-threshold",  tierThresholdAddress},
+#endif
 #ifndef CXXFORTH_DISABLE_FILE_ACCESS
         {"bin",             bin},
         {"close-file",      closeFile},
@@ -2690,10 +9807,17 @@ void definePrimitives() {
         {"read-file",       readFile},
         {"read-line",       readLine},
         {"rename-file",     renameFile},
+        {"save-cxx",        saveCxx},
         {"w/o",             writeOnly},
         {"write-char",      writeChar},
         {"write-file",      writeFile},
+        {"write-fusions",   writeFusions},
         {"write-line",      writeLine},
+#endif
+#ifdef CXXFORTH_FUSIONS_FILE
+#define CXXFORTH_FUSION(fn, name, pattern, body) {name, fn},
+#include CXXFORTH_FUSIONS_FILE
+#undef CXXFORTH_FUSION
 #endif
     };
     for (auto& w: codeWords) {
@@ -2703,14 +9827,79 @@ void definePrimitives() {
     doLiteralXt = findDefinition("(lit)");
     if (doLiteralXt == nullptr) throw runtime_error("Can't find (lit) in kernel dictionary");
 
+    branchXt = findDefinition("(branch)");
+    if (branchXt == nullptr) throw runtime_error("Can't find (branch) in kernel dictionary");
+
+    zbranchXt = findDefinition("(zbranch)");
+    if (zbranchXt == nullptr) throw runtime_error("Can't find (zbranch) in kernel dictionary");
+
+    litPlusXt = findDefinition("(lit+)");
+    if (litPlusXt == nullptr) throw runtime_error("Can't find (lit+) in kernel dictionary");
+
+    litEqualsXt = findDefinition("(lit=)");
+    if (litEqualsXt == nullptr) throw runtime_error("Can't find (lit=) in kernel dictionary");
+
+    dupZbranchXt = findDefinition("(dup-zbranch)");
+    if (dupZbranchXt == nullptr) throw runtime_error("Can't find (dup-zbranch) in kernel dictionary");
+
+    struct { Xt& xt; const char* name; const char* comparisonName; Code comparison; } branches[] = {
+        {nzbranchXt,        "(nzbranch)", "0=", zeroEquals},
+        {equalsBranchXt,    "(=branch)",  "=",  equals},
+        {notEqualsBranchXt, "(<>branch)", "<>", notEquals},
+        {lessBranchXt,      "(<branch)",  "<",  lessThan},
+        {greaterBranchXt,   "(>branch)",  ">",  greaterThan},
+    };
+    branchComparisons.clear();
+    for (auto& fused: branches) {
+        fused.xt = findDefinition(fused.name);
+        if (fused.xt == nullptr)
+            throw runtime_error(string("Can't find ") + fused.name + " in kernel dictionary");
+        // With CXXFORTH_FORTH_CORE_WORDS, some of the comparisons are defined
+        // in Forth, so the translators get a hidden primitive instead.
+        auto comparison = findDefinition(fused.comparisonName);
+        if (comparison == nullptr || comparison->code != fused.comparison) {
+            definePrimitive(fused.comparisonName, fused.comparison);
+            comparison = &definitions.back();
+            comparison->toggleHidden();
+        }
+        branchComparisons[fused.xt] = comparison;
+    }
+
+    tailCallXt = findDefinition("(tail)");
+    if (tailCallXt == nullptr) throw runtime_error("Can't find (tail) in kernel dictionary");
+
+    qdoXt = findDefinition("(?do)");
+    if (qdoXt == nullptr) throw runtime_error("Can't find (?do) in kernel dictionary");
+
+    loopXt = findDefinition("(loop)");
+    if (loopXt == nullptr) throw runtime_error("Can't find (loop) in kernel dictionary");
+
+    plusLoopXt = findDefinition("(+loop)");
+    if (plusLoopXt == nullptr) throw runtime_error("Can't find (+loop) in kernel dictionary");
+
     setDoesXt = findDefinition("(does)");
     if (setDoesXt == nullptr) throw runtime_error("Can't find (does) in kernel dictionary");
 
+    abortXt = findDefinition("abort");
+    if (abortXt == nullptr) throw runtime_error("Can't find ABORT in kernel dictionary");
+
     exitXt = findDefinition("exit");
     if (exitXt == nullptr) throw runtime_error("Can't find EXIT in kernel dictionary");
 
     endOfDefinitionXt = findDefinition("(;)");
     if (endOfDefinitionXt == nullptr) throw runtime_error("Can't find (;) in kernel dictionary");
+
+    localFetchXt = findDefinition("(local@)");
+    if (localFetchXt == nullptr) throw runtime_error("Can't find (local@) in kernel dictionary");
+
+    localStoreXt = findDefinition("(local!)");
+    if (localStoreXt == nullptr) throw runtime_error("Can't find (local!) in kernel dictionary");
+
+    localsXt = findDefinition("(locals)");
+    if (localsXt == nullptr) throw runtime_error("Can't find (locals) in kernel dictionary");
+
+    unlocalsXt = findDefinition("(unlocals)");
+    if (unlocalsXt == nullptr) throw runtime_error("Can't find (unlocals) in kernel dictionary");
 }
 
 /****
@@ -2742,8 +9931,13 @@ I'll start by defining the remaining basic stack operations.  `PICK` and
 Note that while I'm not implementing any of the Forth double-cell arithmetic
 operations, double-cell stack operations are still useful.
 
+The definitions inside `#ifdef CXXFORTH_FORTH_CORE_WORDS` are the core words,
+which are normally implemented as primitives, as described in **Forth Stack
+Operations**.
+
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": over    1 pick ;",
     ": rot     2 roll ;",
     ": nip     swap drop ;",
@@ -2752,6 +9946,7 @@ operations, double-cell stack operations are still useful.
     ": 2dup    over over ;",
     ": 2over   3 pick 3 pick ;",
     ": 2swap   3 roll 3 roll ;",
+#endif
     ": 2>r     swap >r >r ;",
     ": 2r>     r> r> swap ;",
     ": 2r@     r> r> 2dup >r >r swap ;",
@@ -2782,8 +9977,10 @@ Forth has a few words for incrementing/decrementing the top-of-stack value.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": 1+   1 + ;",
     ": 1-   1 - ;",
+#endif
 
     ": cell+   1 cells + ;",
     ": char+   1+ ;",
@@ -2795,7 +9992,9 @@ Forth has a few words for incrementing/decrementing the top-of-stack value.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": +!   dup >r @ + r> ! ;",
+#endif
 
 /****
 
@@ -2803,8 +10002,10 @@ Forth has a few words for incrementing/decrementing the top-of-stack value.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": negate   0 swap - ;",
     ": invert   true xor ;",
+#endif
 
 /****
 
@@ -2814,8 +10015,10 @@ Forth has a few words for incrementing/decrementing the top-of-stack value.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": ,    here  1 cells allot  ! ;",
     ": c,   here  1 chars allot  c! ;",
+#endif
 
 /****
 
@@ -2833,12 +10036,14 @@ mapping to CPU opcodes, but in this system, they are just abbreviations.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": >     swap < ;",
-    ": u>    swap u< ;",
     ": <>    = invert ;",
     ": 0<    0 < ;",
-    ": 0>    0 > ;",
     ": 0=    0 = ;",
+#endif
+    ": u>    swap u< ;",
+    ": 0>    0 > ;",
     ": 0<>   0= invert ;",
 
 /****
@@ -2848,8 +10053,10 @@ right.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": 2*   1 lshift ;",
     ": 2/   1 rshift ;",
+#endif
 
 /****
 
@@ -2864,12 +10071,12 @@ and reserve a cell.
 /****
 
 A Forth constant is similar to a variable in that it is a value stored in
-dataspace, but using the name automatically puts the value on the stack.  I can
-implement this using `CREATE...DOES>`.
+dataspace, but using the name automatically puts the value on the stack.
+`CONSTANT` itself is a C++ primitive with its own code field, but I can
+implement a double-cell constant using `CREATE...DOES>`.
 
 ****/
 
-    ": constant    create ,    does>  @ ;",
     ": 2constant   create , ,  does>  dup cell+ @ swap @ ;",
 
 /****
@@ -2978,15 +10185,46 @@ structures.
 
 ****/
 
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": ?dup       dup if dup then ;",
 
     ": abs        dup 0 < if negate then ;",
 
     ": max        2dup < if swap then drop ;",
     ": min        2dup > if swap then drop ;",
+#endif
 
     ": space      bl emit ;",
+#ifdef CXXFORTH_FORTH_CORE_WORDS
     ": spaces     begin  dup 0> while  space 1-  repeat  drop ;",
+#endif
+
+/****
+
+`DO`, `?DO`, `LOOP`, and `+LOOP` compile the counted-loop primitives described
+in **Counted Loops**.  At compile time, `DO` leaves the address of the start
+of the loop on the stack, for `LOOP` to branch back to.
+
+`LEAVE` can appear any number of times in a loop, inside `IF`s and other
+control structures, so the branches it compiles can't be resolved through the
+data stack like the one compiled by `IF`.  Instead, each `LEAVE` links the
+operand cell of its `(branch)` into a list whose head is in the variable
+`(leaves)`, and `LOOP` walks the list, storing the offset to the end of the
+loop into each cell.  `?DO` adds the operand of its `(?do)` to the same list.
+`DO` saves the list of any enclosing loop on the stack, and `LOOP` restores
+it.
+
+****/
+
+    "variable (leaves)",
+    ": (leave,)           here  (leaves) @ ,  (leaves) ! ;",
+    ": (resolve-leaves)   (leaves) @  begin ?dup while  dup @ swap  here over -  swap !  repeat ;",
+
+    ": do      ['] (do) ,   (leaves) @  0 (leaves) !  here ; immediate",
+    ": ?do     ['] (?do) ,  (leaves) @  0 (leaves) !  (leave,)  here ; immediate",
+    ": leave   ['] unloop ,  ['] (branch) ,  (leave,) ; immediate",
+    ": loop    ['] (loop) ,   here - ,  (resolve-leaves)  (leaves) ! ; immediate",
+    ": +loop   ['] (+loop) ,  here - ,  (resolve-leaves)  (leaves) ! ; immediate",
 
 /****
 
@@ -3002,19 +10240,19 @@ to Google it.
 A Forth `VALUE` is just like a constant in that it puts a value on the stack
 when invoked.  However, the stored value can be modified with `TO`.
 
-`VALUE` is, in fact, exactly the same as `CONSTANT` in this Forth.  And so you
-could use `TO` to change the value of a constant, but that's against the rules.
+`VALUE` is a C++ primitive that works like `CONSTANT`, but gives the word the
+`doValue()` code field so that the optimizer won't treat its value as fixed.
+`TO` stores into the word's data field, or into a local, as described in
+**Locals**.
 
 ****/
 
-    ": value    constant ;",
-
     ": value!   >body ! ;",
 
-    ": to       state @ if",
-    "               postpone ['] postpone value!",
+    ": to       ' state @ if",
+    "               (to-local) 0= if  postpone literal postpone value!  then",
     "           else",
-    "               ' value!",
+    "               value!",
     "           then ; immediate",
 
 /****
@@ -3027,10 +10265,10 @@ as a pointer to a function pointer.
 `DEFER` and `IS` are not ANS Forth standard words, but are in common use, and
 are described formally at <http://forth-standard.org/standard/core/DEFER>.
 
-****/
+`DEFER` is a C++ primitive.  The new word's data field initially holds the xt
+of `ABORT`, and its `doDefer()` code field executes whatever xt is there.
 
-    ": defer       create ['] abort ,",
-    "              does> @ execute ;",
+****/
 
     ": defer@      >body @ ;",
     ": defer!      >body ! ;",
@@ -3049,6 +10287,31 @@ are described formally at <http://forth-standard.org/standard/core/DEFER>.
 
 /****
 
+### Structures
+
+The Forth 2012 structure words describe the layout of a record in memory:
+
+    BEGIN-STRUCTURE point
+        FIELD: p.x
+        FIELD: p.y
+    END-STRUCTURE
+
+Here `point` is a constant giving the size of the record, and `p.x` and `p.y`
+add their offsets to the address of a record.  `BEGIN-STRUCTURE` defines the
+name with `CONSTANT` and leaves the address of its value for `END-STRUCTURE`
+to fill in, along with the running size of the record.  `+FIELD` is a C++
+primitive, defined along with `CONSTANT`, and the optimizer turns its fields
+into `(lit+)` instructions or folds them away entirely.
+
+****/
+
+    ": begin-structure   0 constant  latest >body  0 ;",
+    ": end-structure     swap ! ;",
+    ": field:            aligned 1 cells +field ;",
+    ": cfield:           1 chars +field ;",
+
+/****
+
 Strings
 -------
 
@@ -3269,6 +10532,9 @@ void defineForthWords() {
 
 void initializeDefinitions() {
     definitions.clear();
+    resetTranslations();
+    resetFusions();
+    stackEffects.clear();
     definePrimitives();
     defineForthWords();
 }
@@ -3279,13 +10545,15 @@ const char* cxxforth_version = CXXFORTH_VERSION;
 
 extern "C" void cxxforth_reset() {
 
-    std::memset(dStack, 0, sizeof(dStack));
+    std::memset(dStackCells, 0, (CXXFORTH_DSTACK_COUNT + 1) * sizeof(Cell));
     dTop = dStack - 1;
 
-    std::memset(rStack, 0, sizeof(rStack));
+    std::memset(rStack, 0, CXXFORTH_RSTACK_COUNT * sizeof(Cell));
     rTop = rStack - 1;
+    callTop = callStack - 1;
+    localFrame = nullptr;
 
-    std::memset(dataSpace, 0, sizeof(dataSpace));
+    std::memset(dataSpace, 0, CXXFORTH_DATASPACE_SIZE);
     dataPointer = dataSpace;
 
     initializeDefinitions();
@@ -3298,6 +10566,11 @@ extern "C" int cxxforth_main(int argc, const char** argv) {
 
         cxxforth_reset();
 
+#ifdef CXXFORTH_GUARD_PAGES
+        installGuardPageHandler();
+#endif
+        SET_GUARD_PAGE_RECOVERY();
+
         auto mainXt = findDefinition("MAIN");
         if (!mainXt)
             throw runtime_error("MAIN not defined");
@@ -0,0 +1,40 @@
+\ bench.fs contains a few small benchmarks for the inner interpreter.
+\
+\ Run it like this, and compare times for different builds of cxxforth:
+\
+\     time build/cxxforth tests/bench.fs
+\
+\ `make bench` builds the standard, direct-threaded, token-threaded, and
+\ native-code interpreters and times this script with each of them.
+
+\ Recursive calls
+: fib ( n -- fib[n] )  dup 2 < if exit then  dup 1- recurse  swap 2 - recurse + ;
+
+\ Tight loop of stack and arithmetic primitives
+: sum ( n -- sum[0..n-1] )
+    0 swap begin  dup while  1-  swap over + swap  repeat  drop ;
+
+\ Memory access in a loop
+8192 constant #sieve
+create sieve  #sieve allot
+
+: clear-sieve ( -- )  sieve #sieve 1 fill ;
+
+: strike ( i -- )
+    dup dup + 3 +  swap dup * dup + 6 +   ( step first )
+    begin  dup #sieve <  while
+        0 over sieve + c!  over +
+    repeat  2drop ;
+
+: primes ( -- n )
+    clear-sieve  0  0
+    begin  dup #sieve <  while
+        dup sieve + c@ if  dup strike  swap 1+ swap  then  1+
+    repeat  drop ;
+
+: sieves ( n -- )  begin  dup while  primes drop  1-  repeat  drop ;
+
+27 fib . cr
+5000000 sum . cr
+300 sieves primes . cr
+bye
@@ -0,0 +1,18 @@
+\ helpers.fs defines the words that the test scripts share.  Each test script
+\ starts by including it:
+\
+\     include tests/helpers.fs
+\
+\ so the scripts must be run from the top directory of the source tree.
+
+\ Print "ok" if x1 and x2 are equal, or else "FAIL:" and the name of the test.
+: expect ( x1 x2 c-addr u -- )  2swap = if 2drop ." ok" else ." FAIL: " type then cr ;
+
+\ True if stack underflows are reported.  (If they aren't, PICK just reads the
+\ spare cell below the data stack.)
+: checks? ( -- flag )  depth ['] pick catch  nip 0<> ;
+
+\ Execute xt, which returns a flag, 200 times, and return true if the flag was
+\ true every time.  That is often enough for a tiered build to translate the
+\ words that xt calls.
+: often ( xt -- flag )  true swap  200 0 do  dup execute rot and swap  loop  drop ;
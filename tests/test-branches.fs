@@ -0,0 +1,106 @@
+\ test-branches.fs checks that the optimizations of conditional branches
+\ don't change what a definition does.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-branches.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each test word
+\ is executed often enough to be translated, and must give the same result
+\ every time.
+
+include tests/helpers.fs
+
+-1 1 rshift constant max-n
+max-n invert constant min-n
+
+\ Pairs of operands, including equal ones and the extremes.
+create pairs
+    3 ,  5 ,    5 ,  3 ,    4 ,  4 ,    0 ,  0 ,
+    -1 , 0 ,    0 , -1 ,    min-n , max-n ,    max-n , min-n ,
+8 constant #pairs
+: pair ( i -- a b )  2* cells pairs +  dup @ swap cell+ @ ;
+
+\ True if xt1 and xt2, each ( a b -- n ), give the same results for all pairs.
+variable fused  variable unfused
+: agree ( xt1 xt2 -- flag )
+    unfused ! fused !
+    true  #pairs 0 do  i pair fused @ execute  i pair unfused @ execute  = and  loop ;
+
+\ Comparisons that can't be fused with the branches after them.
+: less ( n1 n2 -- flag )  < ; noinline
+: more ( n1 n2 -- flag )  > ; noinline
+: equal ( x1 x2 -- flag )  = ; noinline
+: unequal ( x1 x2 -- flag )  <> ; noinline
+: zero ( x -- flag )  0= ; noinline
+
+\ Comparisons followed by IF, WHILE, and UNTIL.
+: f-< ( a b -- n )  < if 1 else 2 then ;
+: u-< ( a b -- n )  less if 1 else 2 then ;
+: f-> ( a b -- n )  > if 1 else 2 then ;
+: u-> ( a b -- n )  more if 1 else 2 then ;
+: f-= ( a b -- n )  = if 1 else 2 then ;
+: u-= ( a b -- n )  equal if 1 else 2 then ;
+: f-<> ( a b -- n )  <> if 1 else 2 then ;
+: u-<> ( a b -- n )  unequal if 1 else 2 then ;
+: f-0= ( a b -- n )  drop 0= if 1 else 2 then ;
+: u-0= ( a b -- n )  drop zero if 1 else 2 then ;
+: f-0=0= ( a b -- n )  drop 0= 0= if 1 else 2 then ;
+: u-0=0= ( a b -- n )  drop zero zero if 1 else 2 then ;
+: f-dup ( a b -- n )  drop dup if 1+ then ;
+: u-dup ( a b -- n )  drop dup 0 unequal if 1+ then ;
+: f-while ( a b -- n )  0 >r  begin 2dup < while  swap 1+ swap  r> 1+ >r  r@ 3 = if 2drop r> exit then  repeat  2drop r> ;
+: u-while ( a b -- n )  0 >r  begin 2dup less while  swap 1+ swap  r> 1+ >r  r@ 3 = if 2drop r> exit then  repeat  2drop r> ;
+: f-until ( a b -- n )  drop 3 and  4 begin 1- 2dup = until  nip ;
+: u-until ( a b -- n )  drop 3 and  4 begin 1- 2dup equal until  nip ;
+
+: t-< ( -- flag )  ['] f-< ['] u-< agree  ['] f-> ['] u-> agree and ;
+: t-= ( -- flag )  ['] f-= ['] u-= agree  ['] f-<> ['] u-<> agree and ;
+: t-0= ( -- flag )
+    ['] f-0= ['] u-0= agree  ['] f-0=0= ['] u-0=0= agree and  ['] f-dup ['] u-dup agree and ;
+: t-while ( -- flag )  ['] f-while ['] u-while agree ;
+: t-until ( -- flag )  ['] f-until ['] u-until agree ;
+
+' t-< often  true s" < IF and > IF" expect
+' t-= often  true s" = IF and <> IF" expect
+' t-0= often  true s" 0= IF and DUP IF" expect
+' t-while often  true s" < WHILE" expect
+' t-until often  true s" = UNTIL" expect
+
+\ Branches whose targets are other branches, which the optimizer threads
+\ straight to their final targets, or to an EXIT.  Each "u-" word has a NOP
+\ at the places where those branches would meet, so they aren't threaded.
+: nop ( -- ) ; noinline
+
+\ An inner ELSE branches to the outer ELSE, and an ELSE or THEN to EXIT.
+: f-nested ( n -- m )
+    dup 1 and if  2 and if 10 else 20 then
+    else  4 and if 30 else 40 then  then ;
+: u-nested ( n -- m )
+    dup 1 and if  2 and if 10 else 20 then nop
+    else  4 and if 30 else 40 then nop  then nop ;
+\ An ELSE at the end of a loop branches to REPEAT.
+: f-loop ( n -- odd even )
+    0 0 rot  begin dup while  1- dup 1 and if rot 1+ rot rot else swap 1+ swap then  repeat  drop ;
+: u-loop ( n -- odd even )
+    0 0 rot  begin dup while  1- dup 1 and if rot 1+ rot rot else swap 1+ swap then nop  repeat  drop ;
+\ A WHILE at the end of an IF exits to the ELSE branch.
+: f-while-if ( n -- m )  dup 8 < if  begin dup 8 < while 3 + repeat  else 100 + then  1+ ;
+: u-while-if ( n -- m )  dup 8 < if  begin dup 8 < while 3 + repeat nop  else 100 + then  1+ ;
+\ An IF at the end of a loop branches to AGAIN.
+: f-again ( n -- m )  begin 1+  dup 7 and 0= if exit then  dup 5 = if 2 + then  again ;
+: u-again ( n -- m )  begin 1+  dup 7 and 0= if exit then  dup 5 = if 2 + then nop  again ;
+
+\ True if xt1 and xt2 give the same results for 0 to 19.
+: agree-n ( xt1 xt2 -- flag )
+    unfused ! fused !
+    true  20 0 do  i fused @ execute  i unfused @ execute  = and  loop ;
+: agree-loop ( -- flag )
+    true  20 0 do  i f-loop  i u-loop  rot = >r = r> and  and  loop ;
+: t-threaded ( -- flag )
+    ['] f-nested ['] u-nested agree-n  agree-loop and
+    ['] f-while-if ['] u-while-if agree-n and  ['] f-again ['] u-again agree-n and ;
+
+' t-threaded often  true s" jump threading" expect
+
+bye
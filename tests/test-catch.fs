@@ -0,0 +1,112 @@
+\ test-catch.fs checks CATCH and THROW, and the throw codes of the errors that
+\ cxxforth detects itself.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-catch.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  A build with
+\ CXXFORTH_SKIP_RUNTIME_CHECKS doesn't detect the errors, so those tests are
+\ skipped there.
+
+include tests/helpers.fs
+
+\ Nested CATCHes.
+: throw-1 ( -- )  1 throw ;
+: rethrow ( -- )  ['] throw-1 catch  dup 1 <> if drop 99 then  1+ throw ;
+: nested ( -- code1 code2 )  ['] throw-1 catch  ['] rethrow catch ;
+: no-throw ( -- x )  42 ;
+: throw-0 ( -- x )  7 0 throw ;
+
+nested  2 s" rethrown code" expect  1 s" inner code" expect
+' no-throw catch  0 s" no throw" expect  42 s" no throw result" expect
+' throw-0 catch  0 s" THROW 0" expect  7 s" THROW 0 result" expect
+
+\ THROW through EVALUATE.
+: evaluate-throw ( -- )  s" 3 throw" evaluate ;
+' evaluate-throw catch  3 s" evaluated THROW" expect
+s" 4 throw" ' evaluate catch  4 s" EVALUATE caught" expect  2drop
+s" ' throw-1 catch 5 +" evaluate  6 s" CATCH in EVALUATE" expect
+
+\ CATCH restores the depths of the data and return stacks.
+variable before
+: restores-depth ( xt -- flag )  depth before !  catch drop  depth before @ 1- = ;
+: restores-rstack ( xt -- flag )  12345 >r  catch drop  r> 12345 = ;
+: push-and-throw ( -- )  1 2 3 4 5  6 >r 7 >r  8 throw ;
+
+' push-and-throw restores-depth  true s" data stack depth" expect
+' push-and-throw restores-rstack  true s" return stack depth" expect
+
+\ The errors detected by the kernel.
+: fill ( -- )  begin 0 again ;
+: underflow ( -- )  depth pick ;
+: rfill ( -- )  begin 0 >r again ;
+: deep ( -- )  recurse 0 ;
+: divide ( -- )  depth 0 / ;
+: undefined ( -- )  s" no-such-word" evaluate ;
+
+\ Filling the data space, and then giving the space back, whatever the result.
+: comma-fill ( -- )  begin 0 , again ;
+: c-comma-fill ( -- )  begin 0 c, again ;
+: allot-past ( -- )  unused 1+ allot ;
+: refilled ( xt -- )  here >r  catch  r> here - allot  throw ;
+: data-fill ( -- )  ['] comma-fill refilled ;
+: c-data-fill ( -- )  ['] c-comma-fill refilled ;
+: allot-fill ( -- )  ['] allot-past refilled ;
+
+\ The code that CATCH returns for xt, if it is the same each time that xt is
+\ executed often enough to be translated, or else 0.
+variable first-code  variable same
+: catches ( xt -- code )
+    dup catch first-code !  true same !
+    200 0 do  dup catch first-code @ <> if false same ! then  loop
+    drop  same @ if first-code @ else 0 then ;
+
+: kernel-codes ( -- )
+    ['] fill catches  -3 s" stack overflow" expect
+    ['] underflow catches  -4 s" stack underflow" expect
+    ['] rfill catches  -5 s" return stack overflow" expect
+    ['] deep catches  -5 s" call stack overflow" expect
+    ['] divide catches  -10 s" division by zero" expect
+    ['] undefined catches  -13 s" undefined word" expect
+    ['] data-fill catches  -8 s" data space overflow" expect
+    ['] c-data-fill catches  -8 s" C, data space overflow" expect
+    ['] allot-fill catches  -8 s" ALLOT data space overflow" expect
+    ['] fill restores-depth  true s" stack overflow depth" expect
+    ['] underflow restores-depth  true s" stack underflow depth" expect
+    ['] rfill restores-rstack  true s" return stack overflow depth" expect
+    ['] deep restores-rstack  true s" call stack overflow depth" expect ;
+: ?kernel-codes ( -- )  checks? if kernel-codes else ." skipped kernel error tests" cr then ;
+?kernel-codes
+
+\ A THROW past calls that a tiered build is still interpreting must not leave
+\ anything behind, so a CATCH loop around them doesn't grow the process.  The
+\ size comes from /proc/self/statm, if there is one.
+: throw-1-deep ( -- )  1 throw ; noinline
+: call-deep ( -- x )  throw-1-deep 0 ; noinline
+: call-call-deep ( -- x )  call-deep 0 ; noinline
+: throws ( n -- )  0 ?do  ['] call-call-deep catch drop  loop ;
+
+create statm 80 chars allot
+: digits ( c-addr u -- n )
+    0 rot rot  over + swap ?do
+        i c@ dup [char] 0 < over [char] 9 > or if drop leave then
+        [char] 0 -  swap 10 * +
+    loop ;
+: pages ( -- n )
+    s" /proc/self/statm" r/o open-file if drop 0 exit then
+    >r  statm 80 r@ read-line 2drop  statm swap digits  r> close-file drop ;
+
+\ The address of TIER-THRESHOLD, or 0 if this build doesn't have one.
+: threshold ( -- a-addr | 0 )  s" tier-threshold" ['] evaluate catch if 2drop 0 then ;
+variable saved-threshold
+: interpret-only ( -- )
+    threshold ?dup if  dup @ saved-threshold !  1000000000 swap !  then ;
+: restore-threshold ( -- )  threshold ?dup if  saved-threshold @ swap !  then ;
+
+interpret-only
+100000 throws  pages  1000000 throws  pages swap -
+restore-threshold
+256 <  true s" THROW past interpreted calls" expect
+
+bye
@@ -0,0 +1,71 @@
+\ test-defer.fs checks calls of deferred words, which the translated code
+\ makes through an inline cache of each word's action, and EXECUTEs of
+\ literal XTs, which the optimizer turns into calls.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-defer.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test, and the results
+\ must be the same in every build.  Each test word is executed often enough to
+\ be translated, and must give the same result every time.
+
+include tests/helpers.fs
+
+\ Actions that are colon definitions and primitives, and a deferred word whose
+\ action is another deferred word.
+: add-ten ( n -- n' )  10 + ;
+: times-three ( n -- n' )  3 * ;
+defer op
+defer inner-op
+' add-ten is op
+' times-three is inner-op
+: apply ( n -- n' )  op ;
+: apply-twice ( n -- n' )  op 1+ op ;
+
+: t-colon ( -- flag )  4 apply 14 =  4 apply-twice 25 = and ;
+' t-colon often  true s" deferred colon definition" expect
+
+\ Changing the action after the callers have been translated.
+' times-three is op
+: t-changed ( -- flag )  4 apply 12 =  4 apply-twice 39 = and ;
+' t-changed often  true s" changed action" expect
+
+' negate is op
+: t-primitive ( -- flag )  4 apply -4 =  4 apply-twice 3 = and ;
+' t-primitive often  true s" primitive action" expect
+
+' inner-op is op
+: t-deferred ( -- flag )  4 apply 12 =  ['] add-ten is inner-op  4 apply 14 = and
+    ['] times-three is inner-op ;
+' t-deferred often  true s" deferred action" expect
+
+\ Changing the action on every call, so the cache never stays right.
+: alternate ( -- n )
+    0  10 0 do
+        i 1 and if ['] add-ten else ['] times-three then  is op
+        i op +
+    loop ;
+: t-alternate ( -- flag )  alternate 135 = ;
+' t-alternate often  true s" alternating actions" expect
+
+\ A deferred word that recurses through itself.
+defer fib
+:noname ( n -- fib[n] )  dup 2 < if exit then  dup 1- fib  swap 2 - fib + ; is fib
+: t-recurse ( -- flag )  15 fib 610 = ;
+' t-recurse often  true s" recursion through DEFER" expect
+
+\ ['] X EXECUTE calls X, and keeps calling the same X when it is redefined.
+\ EXECUTE of an XT from the stack, or of a deferred word, is left alone.
+: five ( -- n )  5 ;
+: literal-execute ( -- n )  ['] five execute ;
+: stack-execute ( xt -- n )  execute ;
+: deferred-execute ( n -- n' )  ['] op execute ;
+: five ( -- n )  50 ;
+
+' add-ten is op
+: t-execute ( -- flag )
+    literal-execute 5 =  ['] five stack-execute 50 = and  4 deferred-execute 14 = and ;
+' t-execute often  true s" EXECUTE" expect
+
+bye
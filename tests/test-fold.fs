@@ -0,0 +1,73 @@
+\ test-fold.fs checks that constant folding doesn't change what a definition
+\ does.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-fold.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each "f-" word
+\ applies primitives to literals, which the optimizer folds, and is compared
+\ with a "u-" word that gets the same values from the stack, so nothing in it
+\ can be folded.  A build with CXXFORTH_SKIP_RUNTIME_CHECKS doesn't detect a
+\ division by zero, so those tests are skipped there.
+
+include tests/helpers.fs
+
+\ Arithmetic that overflows wraps around, as it does at run time.
+: f-inc ( -- n )  -1 1 rshift 1+ ;
+: f-mul ( -- n )  -1 1 rshift 3 * ;
+: f-dec ( -- n )  -1 1 rshift invert 1- ;
+: f-neg ( -- n )  -1 1 rshift invert negate ;
+: f-shift ( -- n )  1 8 cells 1- lshift 2* ;
+: u-inc ( n1 n2 -- n )  rshift 1+ ;
+: u-mul ( n1 n2 n3 -- n )  >r rshift r> * ;
+: u-dec ( n1 n2 -- n )  rshift invert 1- ;
+: u-neg ( n1 n2 -- n )  rshift invert negate ;
+: u-shift ( n1 n2 -- n )  lshift 2* ;
+
+f-inc  -1 1 u-inc  s" 1+ wraparound" expect
+f-mul  -1 1 3 u-mul  s" * wraparound" expect
+f-dec  -1 1 u-dec  s" 1- wraparound" expect
+f-neg  -1 1 u-neg  s" NEGATE wraparound" expect
+f-shift  1 8 cells 1- u-shift  s" 2* wraparound" expect
+
+\ Division, comparisons, and stack operations.
+: f-div ( -- n )  -7 2 / ;
+: f-mod ( -- n1 n2 )  -7 2 /mod ;
+: u-div ( n1 n2 -- n )  / ;
+: u-mod ( n1 n2 -- n1 n2 )  /mod ;
+: f-compare ( -- n )  3 5 <  5 3 < 2*  0 -1 u< 4 *  0 0= 8 *  + + + ;
+: u-compare ( n1 n2 n3 n4 n5 -- n )
+    0= 8 * >r  u< 4 * >r  2dup < >r  swap < 2*  r> + r> + r> + ;
+: f-stack ( -- n )  1 2 3 rot over tuck - swap 2* + + + ;
+: u-stack ( n1 n2 n3 -- n )  rot over tuck - swap 2* + + + ;
+
+f-div  -7 2 u-div  s" /" expect
+f-mod  -7 2 u-mod  rot = >r = r> and  true s" /MOD" expect
+f-compare  3 5 0 -1 0 u-compare  s" comparisons" expect
+f-stack  1 2 3 u-stack  s" stack operations" expect
+
+\ A division by zero isn't folded, so it still fails when it is executed, and
+\ not when it is compiled.
+: f-div0 ( -- n )  1 0 / ;
+: f-mod0 ( -- n1 n2 )  7 0 /mod ;
+: divisions ( -- )
+    ['] f-div0 catch  -10 s" / by zero" expect
+    ['] f-mod0 catch  -10 s" /MOD by zero" expect ;
+: ?divisions ( -- )  checks? if divisions else ." skipped division by zero tests" cr then ;
+?divisions
+
+\ A literal compiled by LITERAL is folded with the ones around it, but a
+\ literal can't be folded with one before a branch target.
+: f-literal ( -- n )  [ 6 ] literal [ 7 ] literal * ;
+: f-bracket ( -- n )  [ 2 3 + ] literal 4 * 1+ ;
+: f-then ( flag -- n )  2 swap if drop 3 then 4 * ;
+: f-begin ( -- n )  1 begin 2 * dup 100 > until ;
+
+f-literal  6 7 *  s" LITERAL" expect
+f-bracket  2 3 + 4 * 1+  s" [ ] LITERAL" expect
+true f-then  12 s" THEN taken" expect
+false f-then  8 s" THEN not taken" expect
+f-begin  128 s" BEGIN" expect
+
+bye
@@ -0,0 +1,36 @@
+\ test-fuse.fs checks that superinstructions added by FUSE don't change what
+\ the definitions using them do.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-fuse.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each "u-" word
+\ is compiled before the FUSE commands, so it doesn't use the superinstructions,
+\ and is compared with an "f-" word compiled after them.  Each test word is
+\ executed often enough to be translated, and must give the same result every
+\ time.
+
+include tests/helpers.fs
+
+variable total
+create table  3 , 5 , 7 ,
+
+: u-prims ( n -- x )  0 swap 0 do  i over xor swap  over xor +  loop ;
+: u-mixed ( n -- x )  0 total !  0 do  i cells table + @ total +!  loop  total @ ;
+
+3 fuse over xor swap
+3 fuse over xor +
+2 fuse table +
+3 fuse @ total +!
+
+: f-prims ( n -- x )  0 swap 0 do  i over xor swap  over xor +  loop ;
+: f-mixed ( n -- x )  0 total !  0 do  i cells table + @ total +!  loop  total @ ;
+
+: t-prims ( -- flag )  100 f-prims  100 u-prims = ;
+: t-mixed ( -- flag )  3 f-mixed  3 u-mixed =  3 f-mixed 15 = and ;
+
+' t-prims often  true s" fused primitives" expect
+' t-mixed often  true s" fused CREATEd word" expect
+
+bye
@@ -0,0 +1,65 @@
+\ test-inline.fs checks that inlining short definitions doesn't change what
+\ their callers do.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-inline.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each caller is
+\ defined twice, once with inlining and once with INLINE-LIMIT set to zero, and
+\ the two are executed often enough to be translated, and must give the same
+\ results every time.
+
+include tests/helpers.fs
+
+variable saved-limit
+: no-inlining ( -- )  inline-limit @ saved-limit !  0 inline-limit ! ;
+: inlining ( -- )  saved-limit @ inline-limit ! ;
+
+\ Words that use the return stack, or EXIT before the end.
+: rpeek ( -- x )  r@ ;
+: rtwice ( x -- 2x )  >r r@ r> + ;
+: early ( -- x )  1 exit 2 ;
+: maybe+ ( n -- n' )  dup 0< if exit then 1+ ;
+
+: use-r ( n -- n' )  5 >r rpeek r> + + rtwice ;
+: use-exit ( n -- n' )  early +  maybe+ ;
+no-inlining
+: use-r-called ( n -- n' )  5 >r rpeek r> + + rtwice ;
+: use-exit-called ( n -- n' )  early +  maybe+ ;
+inlining
+
+: t-r ( -- flag )  7 use-r  7 use-r-called =  7 use-r 34 = and ;
+: t-exit ( -- flag )
+    3 use-exit  3 use-exit-called =  3 use-exit 5 = and
+    -9 use-exit  -9 use-exit-called = and  -9 use-exit -8 = and ;
+' t-r often  true s" >R and R>" expect
+' t-exit often  true s" EXIT" expect
+
+\ A caller keeps the definition that was current when it was compiled, whether
+\ it was inlined or not.
+: five ( -- n )  5 ;
+: use-five ( -- n )  five 1+ ;
+no-inlining
+: use-five-called ( -- n )  five 1+ ;
+inlining
+: five ( -- n )  50 ;
+: use-new-five ( -- n )  five 1+ ;
+
+: t-redefined ( -- flag )
+    use-five 6 =  use-five-called 6 = and  use-new-five 51 = and ;
+' t-redefined often  true s" redefined" expect
+
+\ A NOINLINE word's body can be changed after its callers are compiled.  An
+\ inlined word keeps the body it had.
+: ten ( -- n )  10 ; noinline
+: eleven ( -- n )  11 ;
+: use-ten ( -- n )  ten 1+ ;
+: use-eleven ( -- n )  eleven 1+ ;
+20 ' ten >body cell+ !
+22 ' eleven >body cell+ !
+
+: t-noinline ( -- flag )  use-ten 21 =  use-eleven 12 = and ;
+' t-noinline often  true s" NOINLINE" expect
+
+bye
@@ -0,0 +1,58 @@
+\ test-locals.fs checks the Forth 2012 locals, {: ... :}.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-locals.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each test word
+\ is executed often enough to be translated, and must give the same result
+\ every time.
+
+include tests/helpers.fs
+
+\ Initialized and uninitialized locals, and a comment.
+: abc ( a b -- d )  {: a b | c -- d :}  a b - to c  c c * ;
+: uninitialized ( a -- c )  {: a | c :}  c ;
+: t-abc ( -- flag )  7 3 abc 16 =  9 uninitialized 0 =  and ;
+' t-abc often  true s" {: a b | c -- d :}" expect
+
+\ TO on a local, in a loop.
+: count-up ( -- n )  {: | n :}  5 0 do  n 1+ to n  loop  n ;
+: t-to ( -- flag )  count-up 5 = ;
+' t-to often  true s" TO local" expect
+
+\ EXIT, and UNLOOP EXIT, drop the locals.
+: sign ( n -- -1|0|1 )  {: n :}  n 0< if -1 exit then  n 0> if 1 exit then  0 ;
+: index-of ( n -- i )  {: n :}  10 0 do  i n = if i unloop exit then  loop  -1 ;
+: find-pair ( n -- i*j )  {: n :}
+    4 0 do  4 0 do  i j * n = if i j * unloop unloop exit then  loop  loop  -1 ;
+: t-exit ( -- flag )
+    -7 sign -1 =  0 sign 0 = and  7 sign 1 = and
+    3 index-of 3 = and  12 index-of -1 = and
+    6 find-pair 6 = and  7 find-pair -1 = and ;
+' t-exit often  true s" EXIT and UNLOOP EXIT" expect
+
+\ Recursion, with a frame for each call.
+: fact ( n -- n! )  {: n :}  n 2 < if 1 exit then  n 1- recurse  n * ;
+: fib ( n -- fib[n] )  {: n :}  n 2 < if n exit then  n 1- recurse  n 2 - recurse + ;
+: t-recurse ( -- flag )  10 fact 3628800 =  15 fib 610 = and ;
+' t-recurse often  true s" recursion" expect
+
+\ A THROW out of a locals frame, caught by a word with its own locals.
+: thrower ( a b -- )  {: a b :}  a b + throw ;
+: catcher ( x -- code x )  {: x :}  x 1 ['] thrower catch  nip nip  x ;
+: t-throw ( -- flag )  5 catcher 5 =  swap 6 = and ;
+' t-throw often  true s" THROW out of locals" expect
+
+\ A short word with locals inlined into others, with and without locals.
+16 inline-limit !
+: twice ( x -- 2x )  {: x :}  x x + ;
+: inlined ( -- n )  5 twice 1+ ;
+: inlined-in-locals ( a -- n )  {: a :}  a 10 twice a + + ;
+: inlined-in-loop ( -- n )  0  4 0 do  i twice +  loop ;
+6 inline-limit !
+: t-inline ( -- flag )
+    inlined 11 =  3 inlined-in-locals 26 = and  inlined-in-loop 12 = and ;
+' t-inline often  true s" inlined locals" expect
+
+bye
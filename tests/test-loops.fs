@@ -0,0 +1,70 @@
+\ test-loops.fs checks DO, ?DO, LOOP, +LOOP, LEAVE, UNLOOP, I and J.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-loops.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each test word
+\ is executed often enough to be translated, and must give the same result
+\ every time.
+
+include tests/helpers.fs
+
+\ The sum of the indexes, and the number of iterations, of a +LOOP.
+variable step
+: steps ( limit start step -- sum n )  step !  0 0 2swap  do  1+ swap i + swap  step @ +loop ;
+: 2= ( x1 x2 x3 x4 -- flag )  rot = >r = r> and ;
+
+\ Positive steps, which may end on the limit or step over it.
+: t-up ( -- flag )
+    10 0 5 steps  5 2 2=
+    10 0 3 steps  18 4 2= and
+    5 -5 3 steps  -2 4 2= and
+    1 0 1 steps  0 1 2= and ;
+' t-up often  true s" positive +LOOP" expect
+
+\ Negative steps include the limit, and may cross zero.
+: t-down ( -- flag )
+    1 4 -1 steps  10 4 2=
+    -1 2 -1 steps  2 4 2= and
+    0 10 -5 steps  15 3 2= and
+    -6 6 -3 steps  0 5 2= and
+    -7 6 -4 steps  0 4 2= and ;
+' t-down often  true s" negative +LOOP" expect
+
+\ ?DO skips a loop whose limit and start are equal, and DO doesn't.
+: ?do-count ( limit start -- n )  0 rot rot ?do  1+  loop ;
+: ?do-steps ( limit start -- n )  0 rot rot ?do  1+  -1 +loop ;
+: do-once ( -- n )  0  5 5 do  1+ leave  loop ;
+: t-?do ( -- flag )
+    5 5 ?do-count 0 =  0 0 ?do-count 0 = and  -3 -3 ?do-steps 0 = and
+    5 0 ?do-count 5 = and  0 3 ?do-steps 4 = and  do-once 1 = and ;
+' t-?do often  true s" ?DO" expect
+
+\ LEAVE ends only the innermost loop.
+: nested-leave ( -- n outer )
+    0 0  3 0 do  10 0 do  i 2 = if leave then  swap 1+ swap  loop  1+  loop ;
+: leave-+loop ( -- n )  0  -10 10 do  i 0< if leave then  1+  -3 +loop ;
+: t-leave ( -- flag )
+    nested-leave  3 = swap 6 = and  leave-+loop 4 = and ;
+' t-leave often  true s" LEAVE" expect
+
+\ UNLOOP EXIT from one or two loops.
+: first-square-over ( n -- i )
+    100 0 do  i i * over > if drop i unloop exit then  loop  drop -1 ;
+: find-product ( n -- i j )
+    5 1 do  5 1 do  i j * over = if drop i j unloop unloop exit then  loop  loop
+    drop 0 0 ;
+: t-unloop ( -- flag )
+    10 first-square-over 4 =  10000 first-square-over -1 = and
+    12 find-product 4 3 2= and
+    7 find-product 0 0 2= and ;
+' t-unloop often  true s" UNLOOP EXIT" expect
+
+\ J is the index of the enclosing loop, also with ?DO and +LOOP.
+: j-sum ( -- n )  0  3 0 do  4 0 do  j 10 * i + +  loop  loop ;
+: j-steps ( -- n )  0  -4 2 ?do  2 0 ?do  j +  loop  -3 +loop ;
+: t-j ( -- flag )  j-sum 138 =  j-steps -6 = and ;
+' t-j often  true s" J" expect
+
+bye
@@ -0,0 +1,34 @@
+\ test-tail.fs checks tail calls: a colon definition that ends by calling
+\ another one continues in it, without using the call stack.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-tail.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  Each test word
+\ is executed often enough to be translated, and must give the same result
+\ every time.
+
+include tests/helpers.fs
+
+\ A million levels of recursion, far more than the call stack holds, run in
+\ constant space when each call is the last thing the caller does.
+: count-down ( n -- 0 )  dup 0= if exit then  1- recurse ;
+: sum-down ( acc n -- acc' )  dup 0= if drop exit then  tuck + swap 1- recurse ;
+: t-shallow ( -- flag )  100 count-down 0=  0 100 sum-down 5050 = and ;
+' t-shallow often  true s" tail recursion" expect
+1000000 count-down  0 s" deep tail recursion" expect
+0 1000000 sum-down  1000000 2/ 1000001 *  s" deep tail recursion sum" expect
+
+\ A call before ; in a definition with locals isn't a tail call, because the
+\ locals have to be dropped after it returns.  If it were, the callers' locals
+\ would be wrong afterwards.
+: add-down ( acc n -- acc' )  {: acc n :}  n 0= if acc exit then  acc n +  n 1-  recurse ;
+: twice ( x -- 2x )  dup + ; noinline
+: last-call ( x -- 2x )  {: x :}  x twice ;
+: caller ( x -- n )  {: x :}  0 20 add-down  x last-call  +  x + ;
+: t-locals ( -- flag )
+    0 20 add-down 210 =  7 last-call 14 = and  3 caller 219 = and ;
+' t-locals often  true s" no tail call with locals" expect
+
+bye
@@ -0,0 +1,46 @@
+\ test-unchecked.fs checks that UNCHECKED leaves out only the data stack
+\ checks of the definition it follows, and not those of the words it calls.
+\
+\ Run it like this with each build of cxxforth:
+\
+\     build/cxxforth tests/test-unchecked.fs
+\
+\ Each test prints "ok", or "FAIL:" and the name of the test.  A build with
+\ CXXFORTH_SKIP_RUNTIME_CHECKS can't report underflows, so those tests are
+\ skipped there.
+
+include tests/helpers.fs
+
+\ A word whose stack effect is known, and callers whose stack effects aren't.
+: callee ( x1..x9 -- x )  + + + + + + + + ; noinline
+: caller ( x1..x9 -- x 1 )  0 if depth then callee 1 ; unchecked
+: tail-caller ( x1..x9 -- x )  0 if depth then callee ; unchecked
+defer deferred-callee  ' callee is deferred-callee
+: deferred-caller ( x1..x9 -- x 1 )  0 if depth then deferred-callee 1 ; unchecked
+
+\ Call each caller often enough for it to be translated.
+: warm ( -- )
+    1000 0 do
+        1 2 3 4 5 6 7 8 9 caller 2drop
+        1 2 3 4 5 6 7 8 9 tail-caller drop
+        1 2 3 4 5 6 7 8 9 deferred-caller 2drop
+    loop ;
+warm
+
+1 2 3 4 5 6 7 8 9 caller  1 s" caller flag" expect  45 s" caller sum" expect
+1 2 3 4 5 6 7 8 9 tail-caller  45 s" tail-caller sum" expect
+
+\ Each callee underflows, and must still report it.
+: underflows ( -- )
+    1 ['] caller catch  -4 s" caller underflow" expect  1 s" caller depth" expect
+    1 ['] tail-caller catch  -4 s" tail-caller underflow" expect  1 s" tail-caller depth" expect
+    1 ['] deferred-caller catch  -4 s" deferred-caller underflow" expect
+    1 s" deferred-caller depth" expect ;
+: ?underflows ( -- )  checks? if underflows else ." skipped underflow tests" cr then ;
+?underflows
+
+\ A recursive UNCHECKED word.
+: fib ( n -- fib[n] )  dup 2 < if exit then  dup 1- recurse  swap 2 - recurse + ; unchecked
+25 fib  75025 s" recursive fib" expect
+
+bye